@@ -0,0 +1,589 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <calico.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/*****************************************************************************
+ * calico-bench [dim] [games] [threads] [weights]
+ *
+ * Measures the throughput of the rules, pattern, playout and search code on
+ * fixed positions: <games> random games are recorded once from a fixed 
+ * seed, and the position halfway through each is kept. Every benchmark 
+ * then runs on these games and positions, with fixed seeds, so two runs 
+ * do the same work.
+ *
+ * The board backends are compared on the recorded games: at every move, 
+ * each backend checks every point on the board for legality and then places
+ * the move, and at the end of the game, it scores the board. Both backends
+ * must agree on every legality check and every score. The bitboard backend
+ * is only built with BITBOARD=1 (see bitboard.h); otherwise only the 
+ * mailbox board is replayed.
+ *
+ * The pattern policy plays with the neighbor_matcher() weights saved in the
+ * file <weights>, or with the same weight for every pattern if none is 
+ * given.
+ *
+ * Playouts are also run on 1 to <threads> threads at once, one context per
+ * thread, to measure scaling.
+ *
+ * Output is one tab-separated line per benchmark:
+ *
+ *   benchmark  dim  threads  operations  seconds  operations/s
+ */
+
+#define SEED 12345
+#define MAX_MOVES (3 * GO_MAX_DIM * GO_MAX_DIM)
+
+struct game {
+	int length;
+	int move[MAX_MOVES];
+};
+
+static double now(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static uint32_t next(uint64_t *state) {
+
+	*state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+	return *state >> 33;
+}
+
+static void record_game(struct game *game, int dim, uint64_t *state) {
+	struct go_board *board;
+	int legal[GO_MAX_DIM * GO_MAX_DIM];
+	int x, y, n, pass;
+
+	board = go_new(dim);
+	game->length = 0;
+
+	pass = 0;
+	while (pass < 2 && game->length < 3 * dim * dim) {
+		n = 0;
+		for (y = 1; y <= dim; y++) {
+			for (x = 1; x <= dim; x++) {
+				if (!go_check(board, go_get_pos(x, y), board->player)) {
+					legal[n++] = go_get_pos(x, y);
+				}
+			}
+		}
+
+		if (n == 0) {
+			game->move[game->length++] = PASS;
+			pass++;
+		}
+		else {
+			game->move[game->length] = legal[next(state) % n];
+			go_place(board, game->move[game->length++], board->player);
+			pass = 0;
+		}
+
+		board->player = -board->player;
+	}
+
+	free(board);
+}
+
+/*****************************************************************************
+ * replay_go, replay_bit
+ *
+ * Replay <game> on a fresh board of the given backend. Every legality check
+ * and the final score are folded into a checksum, so the two backends can be
+ * compared.
+ */
+
+static uint64_t replay_go(const struct game *game, int dim, long *checks) {
+	struct go_board *board;
+	uint64_t sum;
+	int i, x, y, player;
+
+	board = go_new(dim);
+	player = BLACK;
+	sum = 0;
+
+	for (i = 0; i < game->length; i++) {
+		for (y = 1; y <= dim; y++) {
+			for (x = 1; x <= dim; x++) {
+				sum = sum * 3 + go_check(board, go_get_pos(x, y), player);
+			}
+		}
+		*checks += dim * dim;
+
+		if (game->move[i] != PASS) {
+			go_place(board, game->move[i], player);
+		}
+		player = -player;
+	}
+
+	sum = sum * 31 + go_score(board);
+	free(board);
+
+	return sum;
+}
+
+#ifdef CALICO_BITBOARD
+static uint64_t replay_bit(const struct game *game, int dim, long *checks) {
+	struct bit_board *board;
+	uint64_t sum;
+	int i, x, y, player;
+
+	board = bit_new(dim);
+	player = BLACK;
+	sum = 0;
+
+	for (i = 0; i < game->length; i++) {
+		for (y = 1; y <= dim; y++) {
+			for (x = 1; x <= dim; x++) {
+				sum = sum * 3 + bit_check(board, go_get_pos(x, y), player);
+			}
+		}
+		*checks += dim * dim;
+
+		if (game->move[i] != PASS) {
+			bit_place(board, game->move[i], player);
+		}
+		player = -player;
+	}
+
+	sum = sum * 31 + bit_score(board);
+	free(board);
+
+	return sum;
+}
+#endif
+
+/*****************************************************************************
+ * Operation benchmarks
+ *
+ * Each takes the positions and returns the number of operations it ran; 
+ * results are folded into <sink> so that no work can be optimized away.
+ */
+
+static volatile long sink;
+
+// weight table of the pattern policy
+static struct gen_pattern *pattern;
+
+static long bench_place(struct go_board **pos, const struct game *games, int count) {
+	struct go_board *board;
+	long ops;
+	int i, j;
+
+	ops = 0;
+	for (i = 0; i < count; i++) {
+		board = go_new(pos[0]->dim);
+		for (j = 0; j < games[i].length; j++) {
+			if (games[i].move[j] != PASS) {
+				go_place(board, games[i].move[j], (j & 1) ? WHITE : BLACK);
+				ops++;
+			}
+		}
+		sink += board->hash;
+		free(board);
+	}
+
+	return ops;
+}
+
+static long bench_check(struct go_board **pos, const struct game *games, int count) {
+	long ops, sum;
+	int i, p;
+
+	sum = 0;
+	ops = 0;
+	for (i = 0; i < count; i++) {
+		for (p = 0; p < GO_LIMIT(pos[i]->dim); p++) {
+			sum += go_check(pos[i], p, pos[i]->player);
+		}
+		ops += GO_LIMIT(pos[i]->dim);
+	}
+	sink += sum;
+
+	return ops;
+}
+
+static long bench_group(struct go_board **pos, const struct game *games, int count) {
+	long ops, sum;
+	int i, p, r;
+
+	sum = 0;
+	ops = 0;
+	for (r = 0; r < 16; r++) {
+		for (i = 0; i < count; i++) {
+			for (p = 0; p < GO_LIMIT(pos[i]->dim); p++) {
+				sum += go_get_group(pos[i], p);
+			}
+			ops += GO_LIMIT(pos[i]->dim);
+		}
+	}
+	sink += sum;
+
+	return ops;
+}
+
+static long bench_score(struct go_board **pos, const struct game *games, int count) {
+	long ops, sum;
+	int i, r;
+
+	sum = 0;
+	ops = 0;
+	for (r = 0; r < 16; r++) {
+		for (i = 0; i < count; i++) {
+			sum += go_score(pos[i]);
+			ops++;
+		}
+	}
+	sink += sum;
+
+	return ops;
+}
+
+static long bench_matcher(struct go_board **pos, const struct game *games, int count) {
+	long ops, sum;
+	int i, p;
+
+	sum = 0;
+	ops = 0;
+	for (i = 0; i < count; i++) {
+		for (p = 0; p < GO_LIMIT(pos[i]->dim); p++) {
+			if (go_get_color(pos[i], p) != INVAL) {
+				sum += neighbor_matcher(pos[i], p, pos[i]->player);
+				ops++;
+			}
+		}
+	}
+	sink += sum;
+
+	return ops;
+}
+
+static long bench_mdist(struct go_board **pos, const struct game *games, int count) {
+	struct pat_weight *w;
+	struct mdist *m;
+	struct rng rng;
+	long ops;
+	int i;
+
+	rng_seed(&rng, SEED, 0);
+
+	// every pattern gets a weight, so every empty point gets one
+	w = pat_weight_reward(NULL, 65535, 1.0);
+	for (i = 0; i < 65535; i++) {
+		w->weight[i] = 1.0;
+	}
+
+	ops = 0;
+	for (i = 0; i < count; i++) {
+		m = pat_gen_mdist(pos[i], pos[i]->player, w, neighbor_matcher);
+		sink += mdist_sel(m, &rng);
+		free(m);
+		ops++;
+	}
+
+	free(w->weight);
+	free(w);
+
+	return ops;
+}
+
+static long bench_playout(struct go_board **pos, const struct game *games, int count) {
+	struct playout_ctx *ctx;
+	long ops;
+	int i;
+
+	ctx = playout_new_ctx(SEED, 0);
+	for (i = 0; i < count; i++) {
+		sink += playout(ctx, pos[i]);
+	}
+	ops = ctx->playouts;
+	playout_free_ctx(ctx);
+
+	return ops;
+}
+
+static long bench_playout_light(struct go_board **pos, const struct game *games, int count) {
+	struct playout_ctx *ctx;
+	long ops;
+	int i;
+
+	ctx = playout_new_ctx(SEED, 0);
+	for (i = 0; i < count; i++) {
+		sink += playout_light(ctx, pos[i]);
+	}
+	ops = ctx->playouts;
+	playout_free_ctx(ctx);
+
+	return ops;
+}
+
+// codes are maintained on each position while it is played out, as on the
+// board of a search, and then dropped again for the other benchmarks
+static long bench_playout_pattern(struct go_board **pos, const struct game *games, int count) {
+	struct playout_ctx *ctx;
+	long ops;
+	int i;
+
+	ctx = playout_new_ctx(SEED, 0);
+	ctx->pattern = pattern;
+	playout_set_policy(ctx, "pattern");
+	for (i = 0; i < count; i++) {
+		go_set_patterns(pos[i], 1);
+		sink += playout(ctx, pos[i]);
+		go_set_patterns(pos[i], 0);
+	}
+	ops = ctx->playouts;
+	playout_free_ctx(ctx);
+
+	return ops;
+}
+
+// simulations per position in the search benchmarks
+#define UCT_PLAYOUTS 64
+
+// searches each position with a fresh tree of UCT_PLAYOUTS simulations, 
+// with a transposition table of 2^<table_bits> entries if <table_bits> is
+// nonzero, and PLAYOUT_BATCH simulations at a time if <batch> is nonzero
+static long run_uct(struct go_board **pos, int count, int table_bits, int batch) {
+	struct playout_ctx *ctx;
+	struct uct_node *uct;
+	struct go_board *board;
+	struct go_journal *journal;
+	long ops;
+	int i, j;
+
+	board = malloc(sizeof(struct go_board));
+	journal = go_new_journal();
+	ctx = playout_new_ctx(SEED, 0);
+	ctx->table = (table_bits) ? uct_new_table(table_bits) : NULL;
+
+	ops = 0;
+	for (i = 0; i < count; i++) {
+		go_copy(board, pos[i]);
+		board->journal = journal;
+
+		uct_reset_arena(ctx->arena);
+		if (ctx->table) {
+			uct_clear_table(ctx->table);
+		}
+		uct = new_uct(ctx->arena);
+
+		for (j = 0; j < UCT_PLAYOUTS; ) {
+			if (batch) {
+				j += uct_playout_batch(uct, board, ctx, PLAYOUT_BATCH);
+			}
+			else {
+				uct_playout(uct, board, ctx);
+				j++;
+			}
+		}
+		sink += uct_best_rate(uct);
+		ops += j;
+	}
+
+	uct_free_table(ctx->table);
+	playout_free_ctx(ctx);
+	go_free_journal(journal);
+	free(board);
+
+	return ops;
+}
+
+static long bench_uct(struct go_board **pos, const struct game *games, int count) {
+	return run_uct(pos, count, 0, 0);
+}
+
+static long bench_uct_table(struct go_board **pos, const struct game *games, int count) {
+	return run_uct(pos, count, 16, 0);
+}
+
+static long bench_uct_batch(struct go_board **pos, const struct game *games, int count) {
+	return run_uct(pos, count, 0, 1);
+}
+
+static const struct {
+	const char *name;
+	long (*run)(struct go_board **pos, const struct game *games, int count);
+} benchmarks[] = {
+	{ "go_place",          bench_place },
+	{ "go_check",          bench_check },
+	{ "go_get_group",      bench_group },
+	{ "go_score",          bench_score },
+	{ "neighbor_matcher",  bench_matcher },
+	{ "pat_gen_mdist",     bench_mdist },
+	{ "playout",           bench_playout },
+	{ "playout_light",     bench_playout_light },
+	{ "playout_pattern",   bench_playout_pattern },
+	{ "uct_playout",       bench_uct },
+	{ "uct_playout_table", bench_uct_table },
+	{ "uct_playout_batch", bench_uct_batch },
+};
+
+/*****************************************************************************
+ * Thread scaling
+ *
+ * Every thread runs playouts from the same positions in a context of its 
+ * own, seeded with its own stream.
+ */
+
+struct worker {
+	pthread_t thread;
+	struct go_board **pos;
+	int count;
+	int stream;
+};
+
+static void *bench_worker(void *arg) {
+	struct worker *worker = arg;
+	struct playout_ctx *ctx;
+	int i;
+
+	ctx = playout_new_ctx(SEED, worker->stream);
+	for (i = 0; i < worker->count; i++) {
+		playout(ctx, worker->pos[i]);
+	}
+	playout_free_ctx(ctx);
+
+	return NULL;
+}
+
+static void report(const char *name, int dim, int threads, long ops, double time) {
+	printf("%s\t%d\t%d\t%ld\t%f\t%.0f\n", name, dim, threads, ops, time, ops / time);
+}
+
+int main(int argc, char **argv) {
+	struct game *games;
+	struct go_board **pos;
+	struct worker *worker;
+	struct pat_weight *w;
+	uint64_t state, sum_go, sum_bit;
+	long moves, checks, ops;
+	double start, time_go, time_bit;
+	int dim, count, threads;
+	int i, j, n;
+
+	dim     = (argc > 1) ? atoi(argv[1]) : 9;
+	count   = (argc > 2) ? atoi(argv[2]) : 1000;
+	threads = (argc > 3) ? atoi(argv[3]) : 4;
+
+	if (dim < 1 || dim > GO_MAX_DIM || count < 1 || threads < 1) {
+		fprintf(stderr, "usage: calico-bench [dim] [games] [threads] [weights]\n");
+		return 1;
+	}
+
+	w = NULL;
+	if (argc > 4) {
+		pat_weight_load(&w, argv[4]);
+		if (!w) {
+			fprintf(stderr, "could not load pattern weights %s\n", argv[4]);
+			return 1;
+		}
+	}
+	else {
+		w = pat_weight_reward(NULL, 65535, 1.0);
+		for (i = 0; i < 65535; i++) {
+			w->weight[i] = 1.0;
+		}
+	}
+	pattern = gen_new_pattern(w);
+	free(w->weight);
+	free(w);
+
+	games = malloc(sizeof(struct game) * count);
+	pos = malloc(sizeof(struct go_board *) * count);
+	state = SEED;
+	moves = 0;
+	for (i = 0; i < count; i++) {
+		record_game(&games[i], dim, &state);
+		moves += games[i].length;
+
+		// halfway through the game, with only the moves that were played
+		pos[i] = go_new(dim);
+		for (j = 0; j < games[i].length / 2; j++) {
+			if (games[i].move[j] != PASS) {
+				go_place(pos[i], games[i].move[j], pos[i]->player);
+			}
+			pos[i]->player = -pos[i]->player;
+		}
+	}
+
+	checks = 0;
+	sum_go = 0;
+	start = now();
+	for (i = 0; i < count; i++) {
+		sum_go += replay_go(&games[i], dim, &checks);
+	}
+	time_go = now() - start;
+
+	report("replay_mailbox", dim, 1, moves, time_go);
+
+	#ifdef CALICO_BITBOARD
+	checks = 0;
+	sum_bit = 0;
+	start = now();
+	for (i = 0; i < count; i++) {
+		sum_bit += replay_bit(&games[i], dim, &checks);
+	}
+	time_bit = now() - start;
+
+	report("replay_bitboard", dim, 1, moves, time_bit);
+
+	if (sum_go != sum_bit) {
+		fprintf(stderr, "backends disagree\n");
+		return 1;
+	}
+	#endif
+
+	for (i = 0; i < (int) (sizeof(benchmarks) / sizeof(benchmarks[0])); i++) {
+		start = now();
+		ops = benchmarks[i].run(pos, games, count);
+		report(benchmarks[i].name, dim, 1, ops, now() - start);
+	}
+
+	worker = malloc(sizeof(struct worker) * threads);
+	for (n = 1; n <= threads; n++) {
+		start = now();
+		for (i = 0; i < n; i++) {
+			worker[i].pos = pos;
+			worker[i].count = count;
+			worker[i].stream = i;
+			pthread_create(&worker[i].thread, NULL, bench_worker, &worker[i]);
+		}
+		for (i = 0; i < n; i++) {
+			pthread_join(worker[i].thread, NULL);
+		}
+		report("playout_threads", dim, n, (long) n * count, now() - start);
+	}
+
+	for (i = 0; i < count; i++) {
+		free(pos[i]);
+	}
+	free(worker);
+	free(pos);
+	free(games);
+	free(pattern);
+
+	return 0;
+}
@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <calico.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define W(dim) BIT_WORDS(dim)
+
+typedef uint64_t plane[BIT_MAX_WORDS];
+
+/*****************************************************************************
+ * Plane operations
+ *
+ * All of these loop over a constant number of words once they are inlined
+ * into a kernel, so they vectorize.
+ */
+
+GO_KERNEL void plane_clear(const int dim, plane p) {
+	int i;
+
+	for (i = 0; i < W(dim); i++) {
+		p[i] = 0;
+	}
+}
+
+GO_KERNEL int plane_equal(const int dim, const plane a, const plane b) {
+	uint64_t diff;
+	int i;
+
+	for (diff = 0, i = 0; i < W(dim); i++) {
+		diff |= a[i] ^ b[i];
+	}
+
+	return !diff;
+}
+
+GO_KERNEL int plane_count(const int dim, const plane p) {
+	int i, count;
+
+	for (count = 0, i = 0; i < W(dim); i++) {
+		count += __builtin_popcountll(p[i]);
+	}
+
+	return count;
+}
+
+GO_KERNEL void plane_set(const int dim, plane p, int bit) {
+	p[bit / 64] |= (uint64_t) 1 << (bit % 64);
+}
+
+GO_KERNEL int plane_test(const int dim, const plane p, int bit) {
+	return (p[bit / 64] >> (bit % 64)) & 1;
+}
+
+/*****************************************************************************
+ * plane_adj
+ *
+ * Sets <out> to the set of points on the board adjacent to any point in
+ * <in>. Moving one point right or left is a one-bit shift, and moving one
+ * row up or down is a (dim + 1)-bit shift; the guard bits and the board
+ * mask keep points from wrapping around the edges.
+ */
+
+GO_KERNEL void plane_adj(const int dim, plane out, const plane in, const plane board) {
+	const int row = dim + 1;
+	uint64_t lo1, hi1, lo, hi;
+	int i;
+
+	for (i = 0; i < W(dim); i++) {
+		lo1 = (i > 0) ? in[i - 1] : 0;
+		hi1 = (i < W(dim) - 1) ? in[i + 1] : 0;
+
+		lo = (in[i] << 1)   | (lo1 >> 63);
+		hi = (in[i] >> 1)   | (hi1 << 63);
+		lo |= (in[i] << row) | (lo1 >> (64 - row));
+		hi |= (in[i] >> row) | (hi1 << (64 - row));
+
+		out[i] = (lo | hi) & board[i];
+	}
+}
+
+/*****************************************************************************
+ * plane_flood
+ *
+ * Grows the set <group> until it contains every point of <color> that is
+ * connected to it. Runs in O(d) plane operations, where d is the diameter of
+ * the group.
+ */
+
+GO_KERNEL void plane_flood(const int dim, plane group, const plane color, const plane board) {
+	plane next;
+	int i;
+
+	while (1) {
+		plane_adj(dim, next, group, board);
+
+		for (i = 0; i < W(dim); i++) {
+			next[i] = (next[i] & color[i]) | group[i];
+		}
+
+		if (plane_equal(dim, next, group)) {
+			return;
+		}
+
+		memcpy(group, next, sizeof(plane));
+	}
+}
+
+/*****************************************************************************
+ * Positions
+ *
+ * Converts between go.h positions and bit indices. Returns -1 for positions
+ * that are not on the board.
+ */
+
+GO_KERNEL int bit_index(const int dim, int pos) {
+	int x, y;
+
+	if (pos < GO_STRIDE || pos >= GO_LIMIT(dim)) {
+		return -1;
+	}
+
+	x = pos % GO_STRIDE;
+	y = pos / GO_STRIDE;
+
+	if (x < 1 || x > dim || y > dim) {
+		return -1;
+	}
+
+	return (y - 1) * (dim + 1) + (x - 1);
+}
+
+/* board operations *********************************************************/
+
+struct bit_board *bit_new(int dim) {
+	struct bit_board *board;
+	int x, y, bit;
+
+	if (dim < 1 || dim > GO_MAX_DIM) {
+		return NULL;
+	}
+
+	board = calloc(sizeof(struct bit_board), 1);
+	board->dim = dim;
+	board->ko = PASS;
+	board->last = PASS;
+	board->llast = PASS;
+	board->player = BLACK;
+
+	for (y = 1; y <= dim; y++) {
+		for (x = 1; x <= dim; x++) {
+			bit = (y - 1) * (dim + 1) + (x - 1);
+			board->board[bit / 64] |= (uint64_t) 1 << (bit % 64);
+			board->empty[bit / 64] |= (uint64_t) 1 << (bit % 64);
+		}
+	}
+
+	return board;
+}
+
+struct bit_board *bit_clone(const struct bit_board *board) {
+	struct bit_board *new;
+
+	new = malloc(sizeof(struct bit_board));
+	memcpy(new, board, sizeof(struct bit_board));
+
+	return new;
+}
+
+GO_KERNEL int get_color_kernel(const int dim, const struct bit_board *board, int pos) {
+	int bit;
+
+	bit = bit_index(dim, pos);
+
+	if (bit < 0) {
+		return INVAL;
+	}
+	if (plane_test(dim, board->black, bit)) {
+		return BLACK;
+	}
+	if (plane_test(dim, board->white, bit)) {
+		return WHITE;
+	}
+
+	return EMPTY;
+}
+
+int bit_get_color(const struct bit_board *board, int pos) {
+	GO_DISPATCH(board->dim, get_color_kernel, board, pos);
+}
+
+/*****************************************************************************
+ * group_libs
+ *
+ * Fills <group> with the group containing <bit>, which must hold a stone of
+ * <color>, and <libs> with its liberties.
+ */
+
+GO_KERNEL void group_libs(const int dim, const struct bit_board *board,
+		const plane color, int bit, plane group, plane libs) {
+	int i;
+
+	plane_clear(dim, group);
+	plane_set(dim, group, bit);
+	plane_flood(dim, group, color, board->board);
+	plane_adj(dim, libs, group, board->board);
+
+	for (i = 0; i < W(dim); i++) {
+		libs[i] &= board->empty[i];
+	}
+}
+
+/*****************************************************************************
+ * has_libs
+ *
+ * Returns nonzero if the group containing <bit>, which must hold a stone of
+ * <color>, has a liberty other than the points in <except>. The flood fill
+ * stops as soon as one is found, which is usually after a step or two.
+ */
+
+GO_KERNEL int has_libs(const int dim, const struct bit_board *board,
+		const plane color, int bit, const plane except) {
+	plane group, next;
+	uint64_t libs, grown;
+	int i;
+
+	plane_clear(dim, group);
+	plane_set(dim, group, bit);
+
+	while (1) {
+		plane_adj(dim, next, group, board->board);
+
+		for (libs = 0, grown = 0, i = 0; i < W(dim); i++) {
+			libs |= next[i] & board->empty[i] & ~except[i];
+			next[i] = (next[i] & color[i]) | group[i];
+			grown |= next[i] ^ group[i];
+		}
+
+		if (libs) {
+			return 1;
+		}
+		if (!grown) {
+			return 0;
+		}
+
+		memcpy(group, next, sizeof(plane));
+	}
+}
+
+GO_KERNEL int get_libs_kernel(const int dim, const struct bit_board *board, int pos) {
+	plane group, libs;
+	int color, bit;
+
+	color = get_color_kernel(dim, board, pos);
+	if (color != BLACK && color != WHITE) {
+		return 0;
+	}
+
+	bit = bit_index(dim, pos);
+	group_libs(dim, board, (color == BLACK) ? board->black : board->white, bit, group, libs);
+
+	return plane_count(dim, libs);
+}
+
+int bit_get_libs(const struct bit_board *board, int pos) {
+	GO_DISPATCH(board->dim, get_libs_kernel, board, pos);
+}
+
+/* rule application *********************************************************/
+
+GO_KERNEL int place_kernel(const int dim, struct bit_board *board, int pos, int player) {
+	const int adj[4] = { pos + 1, pos + GO_STRIDE, pos - 1, pos - GO_STRIDE };
+	uint64_t *own, *opp;
+	plane group, none, libs;
+	int i, j, bit, ko, captured;
+
+	own = (player == BLACK) ? board->black : board->white;
+	opp = (player == BLACK) ? board->white : board->black;
+
+	bit = bit_index(dim, pos);
+	own[bit / 64] |= (uint64_t) 1 << (bit % 64);
+	board->empty[bit / 64] &= ~((uint64_t) 1 << (bit % 64));
+
+	// capture all adjacent enemy groups with no liberties
+	captured = 0;
+	ko = PASS;
+	plane_clear(dim, none);
+	for (i = 0; i < 4; i++) {
+		bit = bit_index(dim, adj[i]);
+		if (bit < 0 || !plane_test(dim, opp, bit) || has_libs(dim, board, opp, bit, none)) {
+			continue;
+		}
+
+		plane_clear(dim, group);
+		plane_set(dim, group, bit);
+		plane_flood(dim, group, opp, board->board);
+		for (j = 0; j < W(dim); j++) {
+			opp[j] &= ~group[j];
+			board->empty[j] |= group[j];
+		}
+		captured += plane_count(dim, group);
+		ko = adj[i];
+	}
+
+	// a ko needs a single captured stone, and the new stone alone in atari
+	plane_clear(dim, group);
+	plane_set(dim, group, bit_index(dim, pos));
+	plane_adj(dim, libs, group, board->board);
+	for (j = 0; j < W(dim); j++) {
+		libs[j] &= board->empty[j];
+	}
+	board->ko = (captured == 1 && plane_count(dim, libs) == 1) ? ko : PASS;
+
+	// connecting to an allied group is never a ko
+	for (i = 0; i < 4; i++) {
+		bit = bit_index(dim, adj[i]);
+		if (bit >= 0 && plane_test(dim, own, bit)) {
+			board->ko = PASS;
+		}
+	}
+
+	board->llast = board->last;
+	board->last = pos;
+
+	return 0;
+}
+
+int bit_place(struct bit_board *board, int pos, int player) {
+	GO_DISPATCH(board->dim, place_kernel, board, pos, player);
+}
+
+GO_KERNEL int check_kernel(const int dim, struct bit_board *board, int pos, int player) {
+	const uint64_t *own, *opp;
+	plane stone, adj, group;
+	int i, j, bit;
+
+	// make sure space is on the board and open
+	bit = bit_index(dim, pos);
+	if (bit < 0 || !plane_test(dim, board->empty, bit)) {
+		return 1;
+	}
+
+	// make sure the ko is not retaken immediately
+	if (pos == board->ko && player != get_color_kernel(dim, board, board->last)) {
+		return 1;
+	}
+
+	// a move next to an empty point always has a liberty
+	if ((bit % (dim + 1) > 0 && plane_test(dim, board->empty, bit - 1))
+			|| plane_test(dim, board->empty, bit + 1)
+			|| (bit >= dim + 1 && plane_test(dim, board->empty, bit - (dim + 1)))
+			|| (bit < (dim - 1) * (dim + 1) && plane_test(dim, board->empty, bit + (dim + 1)))) {
+		return 0;
+	}
+
+	own = (player == BLACK) ? board->black : board->white;
+	opp = (player == BLACK) ? board->white : board->black;
+
+	plane_clear(dim, stone);
+	plane_set(dim, stone, bit);
+	plane_adj(dim, adj, stone, board->board);
+
+	// a move that captures something is never suicide
+	for (i = 0; i < W(dim); i++) {
+		while (adj[i] & opp[i]) {
+			j = i * 64 + __builtin_ctzll(adj[i] & opp[i]);
+			adj[i] &= ~((uint64_t) 1 << (j % 64));
+
+			if (!has_libs(dim, board, opp, j, stone)) {
+				return 0;
+			}
+		}
+	}
+
+	// otherwise the move must connect to a group with another liberty
+	for (i = 0; i < W(dim); i++) {
+		group[i] = own[i] | stone[i];
+	}
+
+	return !has_libs(dim, board, group, bit, stone);
+}
+
+int bit_check(struct bit_board *board, int pos, int player) {
+	GO_DISPATCH(board->dim, check_kernel, board, pos, player);
+}
+
+/*****************************************************************************
+ * bit_score
+ *
+ * Same scoring as go_score: every stone counts for its owner, and every
+ * empty point counts for the owner of the first stone found among its
+ * neighbors, in the order right, up, left, down.
+ */
+
+GO_KERNEL int score_kernel(const int dim, struct bit_board *board) {
+	const int row = dim + 1;
+	plane b, w;
+	uint64_t rb, ub, lb, db, rw, uw, lw, dw, lo1, hi1;
+	int i;
+
+	for (i = 0; i < W(dim); i++) {
+		lo1 = (i > 0) ? board->black[i - 1] : 0;
+		hi1 = (i < W(dim) - 1) ? board->black[i + 1] : 0;
+		rb = (board->black[i] >> 1)   | (hi1 << 63);
+		ub = (board->black[i] >> row) | (hi1 << (64 - row));
+		lb = (board->black[i] << 1)   | (lo1 >> 63);
+		db = (board->black[i] << row) | (lo1 >> (64 - row));
+
+		lo1 = (i > 0) ? board->white[i - 1] : 0;
+		hi1 = (i < W(dim) - 1) ? board->white[i + 1] : 0;
+		rw = (board->white[i] >> 1)   | (hi1 << 63);
+		uw = (board->white[i] >> row) | (hi1 << (64 - row));
+		lw = (board->white[i] << 1)   | (lo1 >> 63);
+		dw = (board->white[i] << row) | (lo1 >> (64 - row));
+
+		b[i] = board->black[i] | (board->empty[i] & (rb | (~rw & (ub | (~uw & (lb | (~lw & db)))))));
+		w[i] = board->white[i] | (board->empty[i] & (rw | (~rb & (uw | (~ub & (lw | (~lb & dw)))))));
+	}
+
+	return plane_count(dim, b) - plane_count(dim, w);
+}
+
+int bit_score(struct bit_board *board) {
+	GO_DISPATCH(board->dim, score_kernel, board);
+}
@@ -17,26 +17,58 @@
 #include <calico.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 static int is_bad_move(struct go_board *board, int move, int player);
 
-static double move_weight(const struct go_board *board, int move) {
-	double w;
-	double i;
-	int d, h, d2;
-	double wd, wd2, wh, wi;
-	int a, e, c;
+/*****************************************************************************
+ * tactical_mask
+ *
+ * Sets the bit in <mask> of every move that captures an enemy group, saves a
+ * friendly group in atari, or puts an enemy group in atari, read straight 
+ * from the board's atari and two-liberty lists, which must be enabled. These
+ * are exactly the moves for which go_is_capture(), go_is_extend() or 
+ * go_is_atari() would hold, which move_weight() checks one by one otherwise.
+ */
+
+static void tactical_mask(const struct go_board *board, uint64_t *mask) {
+	int g, i;
 
-	if (is_bad_move((struct go_board *) board, move, board->player)) {
-		return 0.0;
+	for (i = 0; i < GO_MASK_WORDS; i++) {
+		mask[i] = 0;
 	}
 
-	a   = go_is_atari  ((struct go_board *) board, move, board->player);
-	e   = go_is_extend ((struct go_board *) board, move, board->player);
-	c   = go_is_capture((struct go_board *) board, move, board->player);
+	// captures and extensions
+	for (g = board->pos[GO_ATARI].lnext; g != GO_ATARI; g = board->pos[g].lnext) {
+		i = board->pos[g].lib[0];
+		mask[i / 64] |= (uint64_t) 1 << (i % 64);
+	}
 
-	if (a || e || c) return 1.0;
+	// ataris
+	for (g = board->pos[GO_TWO_LIBS].lnext; g != GO_TWO_LIBS; g = board->pos[g].lnext) {
+		if (board->pos[g].color == -board->player) {
+			i = board->pos[g].lib[0];
+			mask[i / 64] |= (uint64_t) 1 << (i % 64);
+			i = board->pos[g].lib[1];
+			mask[i / 64] |= (uint64_t) 1 << (i % 64);
+		}
+	}
+}
+
+static double move_weight(const struct go_board *board, int move, const uint64_t *tactical) {
+	int d, d2;
+
+	if (tactical) {
+		if (GO_MASK_TEST(tactical, move)) return 1.0;
+	}
+	else {
+		if (go_is_atari  ((struct go_board *) board, move, board->player)
+				|| go_is_extend ((struct go_board *) board, move, board->player)
+				|| go_is_capture((struct go_board *) board, move, board->player)) {
+			return 1.0;
+		}
+	}
 	
 	d = go_dist(move, board->last);
 	d2 = go_dist(move, board->llast);
@@ -46,49 +78,138 @@ static double move_weight(const struct go_board *board, int move) {
 	return 0.5;
 }
 
-int gen_move(const struct go_board *board) {
-	static unsigned int seed;
-	int move, i;
-	double x;
-
-	i = 0;
-	while (1) {
-		move = rand_r(&seed) % (GO_DIM * GO_DIM);
-		x = rand_r(&seed) / ((double) RAND_MAX);
-
-		if (x > move_weight(board, move)) {
-			i++;
-			if (i > 10) {
-				for (move = 0; move < GO_DIM * GO_DIM; move++) {
-					if (move_weight(board, move) > 0.0) {
-						return move;
-					}
-				}
-				return PASS;
+/*****************************************************************************
+ * Candidate sampling
+ *
+ * All generators draw moves uniformly from a copy of the board's empty 
+ * point list. A candidate that turns out to be a bad move is removed by 
+ * swapping it with the last candidate, so it is never drawn again, and the
+ * cost of finding a move stays bounded however full the board is. When no
+ * candidates remain, the generator passes.
+ *
+ * The light policy plays the first candidate that is not a bad move. The 
+ * other policies give each candidate a weight of at most 1 and accept it 
+ * with that probability, which draws moves in proportion to their weights:
+ * the heavy policy weights tactical moves and moves near the last two, and
+ * the pattern policy weights moves by their 3x3 pattern (see 
+ * gen_new_pattern()).
+ *
+ * gen_kernel() is written once and takes the policy as a constant, so each
+ * generator is compiled with the features of the other policies removed.
+ *
+ * <rng> is the generator to draw from; each thread must use its own.
+ */
+
+GO_KERNEL int gen_kernel(const int dim, const int policy, const struct go_board *board, 
+		struct rng *rng, const struct gen_pattern *pattern) {
+	int16_t cand[GO_MAX_DIM * GO_MAX_DIM];
+	uint64_t tactical[GO_MASK_WORDS];
+	int move, code, i, n;
+	double w;
+
+	n = board->empties;
+	memcpy(cand, board->empty, sizeof(int16_t) * n);
+	if (policy == GEN_HEAVY && board->tactics) {
+		tactical_mask(board, tactical);
+	}
+
+	while (n > 0) {
+		i = rng_below(rng, n);
+		move = cand[i];
+
+		// a pattern weight is one lookup, much cheaper than is_bad_move(),
+		// so pattern candidates are only checked once they are accepted
+		if (policy == GEN_PATTERN) {
+			code = (board->patterns) ? board->pos[move].pat3 : go_pat3(board, move);
+			w = pattern->weight[(board->player == WHITE) ? PAT3_SWAP(code) : code];
+			if (rng_float(rng) >= w) {
+				continue;
 			}
+		}
+
+		if (is_bad_move((struct go_board *) board, move, board->player)) {
+			cand[i] = cand[--n];
 			continue;
 		}
 
-		return move;
+		if (policy != GEN_HEAVY) {
+			return move;
+		}
+
+		// every weight of the heavy policy is at least 0.5, so it accepts a
+		// move within two draws on average
+		w = move_weight(board, move, (board->tactics) ? tactical : NULL);
+		if (rng_float(rng) < w) {
+			return move;
+		}
 	}
+
+	return PASS;
 }
 
-int gen_move_light(const struct go_board *board) {
-	static unsigned int seed;
-	int move, i;
+GO_KERNEL int gen_heavy_kernel(const int dim, const struct go_board *board, struct rng *rng) {
+	return gen_kernel(dim, GEN_HEAVY, board, rng, NULL);
+}
 
-	i = 0;
-	while (1) {
-		move = rand_r(&seed) % (GO_DIM * GO_DIM);
+GO_KERNEL int gen_light_kernel(const int dim, const struct go_board *board, struct rng *rng) {
+	return gen_kernel(dim, GEN_LIGHT, board, rng, NULL);
+}
 
-		if (is_bad_move((struct go_board *) board, move, board->player)) {
-			i++;
-			if (i > 100) return PASS;
-			continue;
+GO_KERNEL int gen_pattern_kernel(const int dim, const struct go_board *board, 
+		struct rng *rng, const struct gen_pattern *pattern) {
+	return gen_kernel(dim, GEN_PATTERN, board, rng, pattern);
+}
+
+int gen_move(const struct go_board *board, struct rng *rng) {
+	GO_DISPATCH(board->dim, gen_heavy_kernel, board, rng);
+}
+
+int gen_move_light(const struct go_board *board, struct rng *rng) {
+	GO_DISPATCH(board->dim, gen_light_kernel, board, rng);
+}
+
+int gen_move_pattern(const struct go_board *board, struct rng *rng, const struct gen_pattern *pattern) {
+	GO_DISPATCH(board->dim, gen_pattern_kernel, board, rng, pattern);
+}
+
+/*****************************************************************************
+ * gen_new_pattern
+ *
+ * Returns the weight table of the pattern policy for the pattern weights 
+ * <w> (as learned for neighbor_matcher()), or NULL on failure. The table is
+ * indexed directly by the uncanonicalized 3x3 code of a move as seen by 
+ * BLACK, so a lookup needs no canonicalization. Weights are scaled so the
+ * largest is 1, and raised to at least GEN_PATTERN_FLOOR, so that no legal
+ * move is ruled out by a pattern that was never seen. The table may be 
+ * shared between threads; free it with free().
+ */
+
+struct gen_pattern *gen_new_pattern(const struct pat_weight *w) {
+	struct gen_pattern *pattern;
+	double max, value;
+	int code;
+
+	pattern = malloc(sizeof(struct gen_pattern));
+	if (!pattern) {
+		return NULL;
+	}
+
+	// (setup code, which may run before any board exists)
+	pat3_gen_table();
+
+	max = 0.0;
+	for (code = 0; code < w->count && code < 65536; code++) {
+		if (w->weight[code] > max) {
+			max = w->weight[code];
 		}
+	}
 
-		return move;
+	for (code = 0; code < 65536; code++) {
+		value = (pat3_canon[code] < w->count && max > 0.0) ? w->weight[pat3_canon[code]] / max : 0.0;
+		pattern->weight[code] = (value < GEN_PATTERN_FLOOR) ? GEN_PATTERN_FLOOR : value;
 	}
+
+	return pattern;
 }
 
 static int is_bad_move(struct go_board *board, int move, int player) {
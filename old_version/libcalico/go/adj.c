@@ -16,46 +16,12 @@
 
 #include <calico.h>
 
-static int _adj_map[4][GO_DIM * GO_DIM];
-
-static int _go_get_adj(int pos, int direction) {
-	int x, y;
-
-	if (pos == PASS) {
-		return PASS;
-	}
-
-	x = (pos % GO_DIM) + 1;
-	y = (pos / GO_DIM) + 1;
-
-	switch (direction) {
-	case ADJ_R: x++; break;
-	case ADJ_U: y++; break;
-	case ADJ_L: x--; break;
-	case ADJ_D: y--; break;
-	default: return PASS;
-	}
-
-	return go_get_pos(x, y);
-}
-
 int go_get_adj(int pos, int direction) {
+	static const int offset[4] = { 1, GO_STRIDE, -1, -GO_STRIDE };
 
 	if (pos == PASS) {
 		return PASS;
 	}
 
-	return _adj_map[direction][pos];
-}
-
-int go_gen_adj(void) {
-	int i, j;
-
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		for (j = 0; j < 4; j++) {
-			_adj_map[j][i] = _go_get_adj(i, j);
-		}
-	}
-
-	return 0;
+	return pos + offset[direction & 3];
 }
@@ -23,10 +23,10 @@ int go_dist(int move0, int move1) {
 		return 1;
 	}
 
-	x0 = move0 % GO_DIM;
-	y0 = move0 / GO_DIM;
-	x1 = move1 % GO_DIM;
-	y1 = move1 / GO_DIM;
+	x0 = move0 % GO_STRIDE;
+	y0 = move0 / GO_STRIDE;
+	x1 = move1 % GO_STRIDE;
+	y1 = move1 / GO_STRIDE;
 
 	dx = (x0 < x1) ? x1 - x0 : x0 - x1;
 	dy = (y0 < y1) ? y1 - y0 : y0 - y1;
@@ -34,65 +34,50 @@ int go_dist(int move0, int move1) {
 	return (dx + dy + ((dx < dy) ? dy : dx));
 }
 
-int go_height(int move) {
+int go_height(const struct go_board *board, int move) {
 	int x, y;
 
-	x = (move % GO_DIM) + 1;
-	y = (move / GO_DIM) + 1;
+	x = move % GO_STRIDE;
+	y = move / GO_STRIDE;
 
-	if (x > GO_DIM / 2 + 1) x = GO_DIM - x + 1;
-	if (y > GO_DIM / 2 + 1) y = GO_DIM - y + 1;
+	if (x > board->dim / 2 + 1) x = board->dim - x + 1;
+	if (y > board->dim / 2 + 1) y = board->dim - y + 1;
 
 	return (x < y) ? x : y;
 }
 
-int go_is_atari(struct go_board *board, int move, int player) {
-	int group;
+/*****************************************************************************
+ * go_is_atari, go_is_extend, go_is_capture
+ *
+ * Tactical predicates for a move by <player> at <move>, which must be a 
+ * position on the board:
+ *
+ * go_is_atari   - the move puts an adjacent enemy group in atari
+ * go_is_extend  - the move extends an adjacent friendly group in atari
+ * go_is_capture - the move captures an adjacent enemy group
+ */
+
+static int adj_libs(struct go_board *board, int move, int color, int libs) {
+	const int adj[4] = { move + 1, move + GO_STRIDE, move - 1, move - GO_STRIDE };
 	int i;
 
 	for (i = 0; i < 4; i++) {
-		if (go_get_color(board, go_get_adj(move, i)) == -player) {
-			group = go_get_group(board, go_get_adj(move, i));
-
-			if (go_get_libs(board, go_get_adj(move, i)) == 2) {
-				return 1;
-			}
+		if (board->pos[adj[i]].color == color && go_get_libs(board, adj[i]) == libs) {
+			return 1;
 		}
 	}
 
 	return 0;
 }
 
-int go_is_extend(struct go_board *board, int move, int player) {
-	int group;
-	int i;
-
-	for (i = 0; i < 4; i++) {
-		if (go_get_color(board, go_get_adj(move, i)) == player) {
-			group = go_get_group(board, go_get_adj(move, i));
-
-			if (go_get_libs(board, go_get_adj(move, i)) == 1) {
-				return 1;
-			}
-		}
-	}
+int go_is_atari(struct go_board *board, int move, int player) {
+	return adj_libs(board, move, -player, 2);
+}
 
-	return 0;
+int go_is_extend(struct go_board *board, int move, int player) {
+	return adj_libs(board, move, player, 1);
 }
 
 int go_is_capture(struct go_board *board, int move, int player) {
-	int group;
-	int i;
-
-	for (i = 0; i < 4; i++) {
-		if (go_get_color(board, go_get_adj(move, i)) == -player) {
-			group = go_get_group(board, go_get_adj(move, i));
-
-			if (go_get_libs(board, go_get_adj(move, i)) == 1) {
-				return 1;
-			}
-		}
-	}
-
-	return 0;
+	return adj_libs(board, move, -player, 1);
 }
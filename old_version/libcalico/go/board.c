@@ -18,30 +18,95 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 
-struct go_board *go_new(void) {
+/*****************************************************************************
+ * go_new
+ *
+ * Returns a new empty board with side length <dim>, or NULL if <dim> is not
+ * between 1 and GO_MAX_DIM.
+ */
+
+struct go_board *go_new(int dim) {
 	struct go_board *board;
-	int i;
+	int i, x, y;
+
+	if (dim < 1 || dim > GO_MAX_DIM) {
+		return NULL;
+	}
 
 	board = calloc(sizeof(struct go_board), 1);
+	board->dim = dim;
 	board->ko = PASS;
 	board->last = PASS;
+	board->llast = PASS;
 	board->player = BLACK;
 
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
+	// the empty board hashes to zero; the shared tables are filled here, 
+	// before any thread can read them
+	go_gen_zobrist();
+	pat3_gen_table();
+	board->hash = 0;
+	board->superko = 0;
+	board->tactics = 0;
+	board->patterns = 0;
+
+	// every position starts out as its own group; only the board is EMPTY
+	for (i = 0; i < GO_SIZE; i++) {
 		board->pos[i].group = i;
+		board->pos[i].next  = i;
+		board->pos[i].lprev = PASS;
+		board->pos[i].lnext = PASS;
+		board->pos[i].color = INVAL;
 	}
 
-	go_gen_adj();
+	// the group lists start out empty
+	board->pos[GO_ATARI].lprev = board->pos[GO_ATARI].lnext = GO_ATARI;
+	board->pos[GO_TWO_LIBS].lprev = board->pos[GO_TWO_LIBS].lnext = GO_TWO_LIBS;
+
+	board->empties = 0;
+	for (x = 1; x <= dim; x++) {
+		for (y = 1; y <= dim; y++) {
+			i = go_get_pos(x, y);
+			board->pos[i].color = EMPTY;
+			board->pos[i].index = board->empties;
+			board->empty[board->empties++] = i;
+		}
+	}
 
 	return board;
 }
 
+/*****************************************************************************
+ * go_clone
+ *
+ * Returns a copy of <board>. Only the positions used by a board of this size
+ * are copied, so cloning a small board stays cheap. The copy has no undo
+ * journal.
+ */
+
 struct go_board *go_clone(const struct go_board *board) {
 	struct go_board *new;
 
 	new = malloc(sizeof(struct go_board));
-	memcpy(new, board, sizeof(struct go_board));
+	go_copy(new, board);
 
 	return new;
 }
+
+/*****************************************************************************
+ * go_copy
+ *
+ * Copies <src> into the existing board <dst>, with the same rules as 
+ * go_clone(), but without allocating anything. Returns <dst>.
+ */
+
+struct go_board *go_copy(struct go_board *dst, const struct go_board *src) {
+
+	memcpy(dst, src, offsetof(struct go_board, pos[GO_LIMIT(src->dim)]));
+
+	// a journal belongs to exactly one board
+	dst->journal = NULL;
+
+	return dst;
+}
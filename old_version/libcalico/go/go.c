@@ -18,17 +18,18 @@
 
 int go_get_pos(int x, int y) {
 	
-	// bounds go_check
-	if (x <= 0 || x > GO_DIM || y <= 0 || y > GO_DIM) {
+	// bounds go_check (points outside of smaller boards are INVAL)
+	if (x <= 0 || x > GO_MAX_DIM || y <= 0 || y > GO_MAX_DIM) {
 		return PASS;
 	}
 
-	return (((y - 1) * GO_DIM) + (x - 1));
+	return ((y * GO_STRIDE) + x);
 }
 
 int go_get_color(const struct go_board *board, int pos) {
 	
-	if (pos == PASS || pos >= GO_DIM * GO_DIM) {
+	// PASS wraps around to a large unsigned value
+	if ((unsigned) pos >= (unsigned) GO_LIMIT(board->dim)) {
 		return INVAL;
 	}
 
@@ -17,162 +17,404 @@
 #include <calico.h>
 
 /*****************************************************************************
- * go_get_group
+ * Group representation
  *
- * Returns the position of the leader of the group at <pos>. Returns PASS on
- * error.
+ * Every stone holds the position of its group leader in <group>, and the 
+ * stones of each group are linked into a circular list through <next>. Only
+ * the leader's <libs> and <size> fields are meaningful: <libs> is the exact
+ * number of distinct empty points next to the group, and <size> the number
+ * of stones in it. Empty and border positions are their own leaders, with
+ * no liberties and no stones.
  *
- * Notes:
+ * When two groups merge, the smaller one is relabeled, so finding a leader
+ * is a single lookup, and merges and captures only touch the stones that 
+ * actually change.
+ *
+ * With go_set_tactics() enabled, the leaders of groups with one or two 
+ * liberties are also linked into two circular lists through <lprev> and 
+ * <lnext>, headed by the border pieces GO_ATARI and GO_TWO_LIBS, and hold 
+ * their liberties in <lib>. Any leader whose liberties change is passed to
+ * go_track_group() through GO_TRACK(), which moves it to the right list; 
+ * <lprev> and <lnext> are PASS for groups in neither list. Because the lists
+ * live in pieces, the undo journal restores them like any other piece data.
  *
- * The currently commented-out code guarantees much better asymptotic
- * performance; however, in practice, it slows down the whole program
- * by a significant margin (~35%). This is likely because the set tree
- * will rarely become more than one layer deep, unless multiple large
- * groups are merged, which is much less common than a single piece
- * being merged with a large group. 
+ * Keeping the lists costs about a fifth of the speed of a light playout on
+ * 9x9 (mostly in refreshing the liberties of merged groups), which is why
+ * they are optional.
+ */
+
+#define ADJ(pos) { (pos) + 1, (pos) + GO_STRIDE, (pos) - 1, (pos) - GO_STRIDE }
+
+/*****************************************************************************
+ * go_get_group
  *
- * If that code is put back in, this function runs in inverse Ackermann 
- * function time (effectively O(1)) with respect to group size.
+ * Returns the position of the leader of the group at <pos>. <pos> must be a
+ * position on the board or on its border; empty and border positions are
+ * always their own leaders.
  *
- * This function runs O(lg(n)) time where n is the group size.
+ * This function runs in O(1) time.
  */
 
 int go_get_group(struct go_board *board, int pos) {
+	return board->pos[pos].group;
+}
+
+/*****************************************************************************
+ * is_adjacent
+ *
+ * Returns nonzero if any of the four neighbors of <pos> belongs to the group
+ * led by <g>.
+ */
+
+static int is_adjacent(struct go_board *board, int pos, int g) {
+	const int adj[4] = ADJ(pos);
+
+	return (board->pos[adj[0]].group == g || board->pos[adj[1]].group == g
+		|| board->pos[adj[2]].group == g || board->pos[adj[3]].group == g);
+}
+
+/*****************************************************************************
+ * go_track_group
+ *
+ * Puts the group led by <g> into the list matching its liberty count (see 
+ * above), refreshing its liberty points, or takes it out of both lists if it
+ * has more than two liberties or <g> is no longer the leader of a group. 
+ * Must be called whenever the liberties of a group change. <hint> is the 
+ * single point that was just added to or removed from its liberties, or 
+ * PASS if that is not known. Returns zero.
+ *
+ * Notes:
+ *
+ * When a group moves between the two lists because of <hint>, its new
+ * liberties follow from its old ones; otherwise they are found with 
+ * go_find_libs(). This function runs in O(1) time in the first case, and 
+ * O(n) time where n is the size of the group in the second.
+ */
+
+int go_track_group(struct go_board *board, int g, int hint) {
+	struct go_piece *piece = &board->pos[g];
+	int lib[2];
+	int head, old;
 
-	// filter invalid positions
-	if (pos < 0 || pos >= GO_DIM * GO_DIM) {
-		return PASS;
+	// most groups are in neither list before or after
+	if (piece->lnext == PASS && (piece->libs > 2 || piece->libs < 1)) {
+		return 0;
 	}
 
-	if (board->pos[pos].group == pos) {
-		return pos;
+	GO_SAVE(board, g);
+
+	// liberties before the change: 1 or 2 if listed, otherwise unknown
+	old = (piece->lnext == PASS) ? 0 : (piece->lib[1] == PASS) ? 1 : 2;
+
+	if (piece->group != g || (piece->color != BLACK && piece->color != WHITE)
+			|| piece->libs < 1 || piece->libs > 2) {
+		head = PASS;
 	}
 	else {
-//		board->pos[pos].group = get_group(board, board->pos[pos].group);
-//		return board->pos[pos].group;
-		return go_get_group(board, board->pos[pos].group);
+		head = (piece->libs == 1) ? GO_ATARI : GO_TWO_LIBS;
+
+		if (hint != PASS && old == 2 && piece->libs == 1) {
+			lib[0] = (piece->lib[0] == hint) ? piece->lib[1] : piece->lib[0];
+		}
+		else if (hint != PASS && old == 1 && piece->libs == 2) {
+			lib[0] = piece->lib[0];
+			lib[1] = hint;
+		}
+		else {
+			go_find_libs(board, g, lib, 2);
+		}
+
+		piece->lib[0] = lib[0];
+		piece->lib[1] = (piece->libs == 2) ? lib[1] : PASS;
+
+		// already in the right list
+		if (old == piece->libs) {
+			return 0;
+		}
+	}
+
+	if (old) {
+		GO_SAVE(board, piece->lprev);
+		GO_SAVE(board, piece->lnext);
+		board->pos[piece->lprev].lnext = piece->lnext;
+		board->pos[piece->lnext].lprev = piece->lprev;
+	}
+
+	if (head == PASS) {
+		piece->lprev = PASS;
+		piece->lnext = PASS;
+		return 0;
 	}
+
+	GO_SAVE(board, head);
+	GO_SAVE(board, board->pos[head].lnext);
+	piece->lprev = head;
+	piece->lnext = board->pos[head].lnext;
+	board->pos[piece->lnext].lprev = g;
+	board->pos[head].lnext = g;
+
+	return 0;
+}
+
+/*****************************************************************************
+ * go_set_tactics
+ *
+ * Starts (<enable> nonzero) or stops maintaining the atari and two-liberty
+ * lists of <board>. Starting builds the lists from scratch. The setting is
+ * not recorded in the undo journal, so it should not be changed while moves
+ * are being undone. Returns zero.
+ *
+ * Nothing in calico enables the lists; only calico-perft -v checks them. 
+ * The heavy policy reads its tactical moves from them when they are on 
+ * (see gen.c), but keeping them up to date costs more than it saves: heavy
+ * playouts run about 20% slower on 9x9 and 30% slower on 19x19 with them.
+ */
+
+int go_set_tactics(struct go_board *board, int enable) {
+	int i;
+
+	board->tactics = enable;
+
+	for (i = 0; i < GO_LIMIT(board->dim); i++) {
+		GO_SAVE(board, i);
+		board->pos[i].lprev = PASS;
+		board->pos[i].lnext = PASS;
+	}
+	board->pos[GO_ATARI].lprev = board->pos[GO_ATARI].lnext = GO_ATARI;
+	board->pos[GO_TWO_LIBS].lprev = board->pos[GO_TWO_LIBS].lnext = GO_TWO_LIBS;
+
+	// (the list heads are on the border, and must not be tracked themselves)
+	if (enable) {
+		for (i = GO_STRIDE; i < GO_LIMIT(board->dim) - GO_STRIDE; i++) {
+			if (board->pos[i].color != INVAL) {
+				GO_TRACK(board, i, PASS);
+			}
+		}
+	}
+
+	return 0;
 }
 
 /*****************************************************************************
  * go_merge_group
  *
- * Combines the groups that contain the positions <g1> and <g2>. The group
- * leader of this new group is selected from the group leaders of the two
- * constituent groups. Returns the new group leader on success, PASS on error.
+ * Combines the groups that contain the positions <g1> and <g2>. The leader 
+ * of the larger group leads the new group. Returns the new group leader on
+ * success, PASS if both positions are already in the same group. The caller
+ * must pass the new leader to go_track_group() when it is done merging.
  *
  * Notes:
  *
- * This function runs in O(lg(n)) time where n is the larger of the two group
- * sizes. If g1 and g2 are both group leaders, this function runs in O(1) 
- * time.
+ * A liberty of the smaller group is new to the larger group unless it is
+ * already next to one of its stones; each such liberty is counted once, from
+ * the first of its neighbors (in ADJ order) that is in the smaller group.
+ *
+ * This function runs in O(n) time where n is the size of the smaller group.
  */
 
 int go_merge_group(struct go_board *board, int g1, int g2) {
+	int big, small;
 	int libs;
-	int g3;
+	int s, i, k;
 
 	g1 = go_get_group(board, g1);
 	g2 = go_get_group(board, g2);
 
-	if (g1 == g2 || g1 == PASS || g2 == PASS) return PASS;
+	if (g1 == g2) return PASS;
 
-	libs = board->pos[g1].libs + board->pos[g2].libs;
-
-	if (board->pos[g1].rank < board->pos[g2].rank) {
-		board->pos[g1].group = g2;
-		g3 = g2;
-	}
-	else if (board->pos[g1].rank > board->pos[g2].rank) {
-		board->pos[g2].group = g1;
-		g3 = g1;
+	if (board->pos[g1].size < board->pos[g2].size) {
+		big = g2;
+		small = g1;
 	}
 	else {
-		board->pos[g1].group = g2;
-		board->pos[g2].rank++;
-		g3 = g2;
+		big = g1;
+		small = g2;
 	}
 
-	board->pos[g3].libs = libs;
+	// count liberties of the smaller group that the larger group lacks
+	libs = board->pos[big].libs;
+	s = small;
+	do {
+		const int adj[4] = ADJ(s);
+
+		for (i = 0; i < 4; i++) {
+			if (board->pos[adj[i]].color != EMPTY || is_adjacent(board, adj[i], big)) {
+				continue;
+			}
+			const int ladj[4] = ADJ(adj[i]);
+			for (k = 0; board->pos[ladj[k]].group != small; k++);
+			if (ladj[k] == s) {
+				libs++;
+			}
+		}
+
+		s = board->pos[s].next;
+	} while (s != small);
+
+	// relabel the smaller group
+	s = small;
+	do {
+		GO_SAVE(board, s);
+		board->pos[s].group = big;
+		s = board->pos[s].next;
+	} while (s != small);
+
+	// splice the two stone lists together
+	GO_SAVE(board, big);
+	s = board->pos[big].next;
+	board->pos[big].next = board->pos[small].next;
+	board->pos[small].next = s;
+
+	board->pos[big].size += board->pos[small].size;
+	board->pos[big].libs = libs;
+
+	// the smaller group no longer has a leader of its own; the caller tracks
+	// the new group once it is complete
+	GO_TRACK(board, small, PASS);
 
-	return g3;
+	return big;
 }
 
 /*****************************************************************************
  * go_capture_group
  *
  * Removes all elements of the group containing the position <pos> from the
- * board, updating liberty information. Returns zero on success, nonzero on 
- * error.
+ * board, updating liberty information, the empty point list and the board
+ * hash. <pos> must contain a stone. Returns the number of stones removed.
  *
  * Notes:
  *
+ * Every removed stone becomes a liberty of each distinct enemy group next to
+ * it. All stones are removed before any liberties are added, so that stones
+ * of the captured group are never mistaken for neighbors.
+ *
  * This function runs in O(n) time where n is the size of the group.
  */
 
 int go_capture_group(struct go_board *board, int pos) {
 	int color;
-	int color1;
+	int count;
+	int g, s, next;
 	int i;
 
-	if (pos < 0 || pos > GO_DIM * GO_DIM) {
-		return 1;
-	}
-
-	color = go_get_color(board, pos);
-	board->pos[pos].color = EMPTY;
-	board->pos[pos].group = PASS;
-	board->pos[pos].libs  = 0;
-	board->pos[pos].rank  = 0;
+	g = go_get_group(board, pos);
+	color = board->pos[g].color;
+	count = board->pos[g].size;
 
-	for (i = 0; i < 4; i++) {
-		color1 = go_get_color(board, go_get_adj(pos, i));
-		if (color1 == -color) {
-			go_add_libs(board, go_get_adj(pos, i), 1);
+	s = g;
+	do {
+		GO_SAVE(board, s);
+		board->hash ^= GO_ZOBRIST(color, s);
+		board->pos[s].color = EMPTY;
+		if (board->patterns) {
+			go_pat3_flip(board, s, color);
 		}
-		else if (color1 == color) {
-			go_capture_group(board, go_get_adj(pos, i));
+		s = board->pos[s].next;
+	} while (s != g);
+
+	GO_TRACK(board, g, PASS);
+
+	s = g;
+	do {
+		const int adj[4] = ADJ(s);
+		int group[4];
+
+		next = board->pos[s].next;
+
+		for (i = 0; i < 4; i++) {
+			group[i] = board->pos[adj[i]].group;
+			if (board->pos[adj[i]].color == -color
+					&& (i < 1 || group[i] != group[0])
+					&& (i < 2 || group[i] != group[1])
+					&& (i < 3 || group[i] != group[2])) {
+				GO_SAVE(board, group[i]);
+				board->pos[group[i]].libs++;
+
+				// groups with more liberties than this were in neither list
+				if (board->pos[group[i]].libs <= 3) {
+					GO_TRACK(board, group[i], s);
+				}
+			}
 		}
-	}
 
-	return 0;
+		board->pos[s].group = s;
+		board->pos[s].next  = s;
+		board->pos[s].libs  = 0;
+		board->pos[s].size  = 0;
+		board->pos[s].index = board->empties;
+		board->empty[board->empties++] = s;
+
+		s = next;
+	} while (s != g);
+
+	return count;
 }
 
 /*****************************************************************************
  * go_get_libs
  *
- * Returns the number of liberties in the group containing the position <pos>.
- * Returns negative on error.
+ * Returns the exact number of liberties of the group containing the position
+ * <pos>. Returns zero if <pos> is empty or on the border. Runs in O(1) time.
  */
 
 int go_get_libs(struct go_board *board, int pos) {
-	int group;
-	
-	group = go_get_group(board, pos);
-
-	if (group < 0 || group > GO_DIM * GO_DIM) {
-		return -1;
-	}
-
-	return board->pos[group].libs;
+	return board->pos[go_get_group(board, pos)].libs;
 }
 
 /*****************************************************************************
  * go_add_libs
  *
  * Adds <value> to the number of liberties in the group containing the
- * position <pos>. Returns zero on success, nonzero on error.
+ * position <pos>. Returns zero.
  */
 
 int go_add_libs(struct go_board *board, int pos, int value) {
 
-	pos = go_get_group(board, pos);
+	GO_SAVE(board, go_get_group(board, pos));
+	board->pos[go_get_group(board, pos)].libs += value;
+
+	return 0;
+}
 
-	if (pos < 0 || pos > GO_DIM * GO_DIM) {
-		return 1;
+/*****************************************************************************
+ * go_find_libs
+ *
+ * Stores the positions of up to <max> liberties of the group containing the
+ * stone at <pos> in <libs>, and returns how many were stored. Liberties are
+ * listed in stone list order, each one once.
+ *
+ * This function runs in O(n) time where n is the size of the group, and 
+ * stops as soon as <max> liberties are found, so finding the liberty of a
+ * group in atari is cheap.
+ */
+
+int go_find_libs(struct go_board *board, int pos, int *libs, int max) {
+	int g, s, n;
+	int i, j;
+
+	g = go_get_group(board, pos);
+	n = 0;
+
+	if (max > board->pos[g].libs) {
+		max = board->pos[g].libs;
 	}
 
-	board->pos[pos].libs += value;
+	s = g;
+	do {
+		const int adj[4] = ADJ(s);
 
-	return 0;
+		for (i = 0; i < 4 && n < max; i++) {
+			if (board->pos[adj[i]].color != EMPTY) {
+				continue;
+			}
+			for (j = 0; j < n && libs[j] != adj[i]; j++);
+			if (j == n) {
+				libs[n++] = adj[i];
+			}
+		}
+
+		s = board->pos[s].next;
+	} while (s != g && n < max);
+
+	return n;
 }
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <calico.h>
+
+#include <string.h>
+
+/*****************************************************************************
+ * Zobrist hashing
+ *
+ * Every combination of stone color and position has a random 64-bit key, as
+ * do the side to move and every possible ko point. board->hash is the XOR of
+ * the keys of all stones on the board, and is kept up to date by go_place()
+ * and go_capture_group(); go_hash() adds in the side to move and the ko 
+ * point, which are only known to the caller.
+ *
+ * The keys are generated by a fixed-seed generator, so hashes are the same
+ * from one run to the next.
+ */
+
+uint64_t go_zobrist[2][GO_SIZE];
+
+static uint64_t _ko_key[GO_SIZE];
+static uint64_t _white_key;
+
+int go_gen_zobrist(void) {
+	static int done = 0;
+	uint64_t state;
+	int i;
+
+	if (done) {
+		return 0;
+	}
+
+	state = 0x63616C69636FULL;
+
+	for (i = 0; i < GO_SIZE; i++) {
+		go_zobrist[0][i] = rng_splitmix(&state);
+		go_zobrist[1][i] = rng_splitmix(&state);
+		_ko_key[i] = rng_splitmix(&state);
+	}
+	_white_key = rng_splitmix(&state);
+
+	done = 1;
+	return 0;
+}
+
+/*****************************************************************************
+ * go_hash
+ *
+ * Returns the Zobrist hash of the full game state: the stones on the board,
+ * the side to move and the ko point. Runs in O(1) time.
+ */
+
+uint64_t go_hash(const struct go_board *board) {
+	uint64_t hash;
+
+	hash = board->hash;
+
+	if (board->player == WHITE) {
+		hash ^= _white_key;
+	}
+	if (board->ko != PASS) {
+		hash ^= _ko_key[board->ko];
+	}
+
+	return hash;
+}
+
+/*****************************************************************************
+ * Positional superko
+ *
+ * When enabled, the board remembers the hashes of the last GO_HISTORY 
+ * positions (stones only), and go_check() rejects any move that would 
+ * recreate one of them. A Bloom filter over the remembered hashes rejects
+ * most candidate positions without scanning the history. Each hash sets 
+ * two bits in one word of the filter, so a test is a single load.
+ *
+ * Positions cannot be removed from a Bloom filter, so it has two 
+ * generations of GO_HISTORY positions each (see GO_BLOOM_GEN()). A 
+ * generation is cleared when it starts to be filled again, by which time
+ * all of its positions have been forgotten, and a test checks both. The 
+ * filter thus covers between GO_HISTORY and 2 * GO_HISTORY positions; 
+ * with a full history, about one check in forty of a position that is 
+ * not there scans the history.
+ */
+
+#define BLOOM_WORD(hash) ((hash) >> 61)
+#define BLOOM(hash) (((uint64_t) 1 << (((hash) >> 55) & 63)) | ((uint64_t) 1 << (((hash) >> 49) & 63)))
+
+/*****************************************************************************
+ * go_set_superko
+ *
+ * Enables (<enable> nonzero) or disables positional superko detection on
+ * <board>. Enabling it clears the history and records the current position.
+ * Returns zero.
+ */
+
+int go_set_superko(struct go_board *board, int enable) {
+
+	board->superko = enable;
+	board->history_len = 0;
+	memset(board->history_bloom, 0, sizeof(board->history_bloom));
+
+	if (enable) {
+		go_add_history(board);
+	}
+
+	return 0;
+}
+
+/*****************************************************************************
+ * go_add_history
+ *
+ * Records the current position in the superko history, forgetting the 
+ * oldest position if the history is full. Returns zero.
+ */
+
+int go_add_history(struct go_board *board) {
+	uint64_t *bloom;
+	int slot;
+
+	slot = board->history_len % GO_HISTORY;
+	bloom = board->history_bloom[GO_BLOOM_GEN(board->history_len)];
+
+	if (slot == 0) {
+		// the generation's positions were forgotten GO_HISTORY positions ago
+		memset(bloom, 0, GO_BLOOM_WORDS * sizeof(uint64_t));
+	}
+
+	board->history[slot] = board->hash;
+	bloom[BLOOM_WORD(board->hash)] |= BLOOM(board->hash);
+	board->history_len++;
+
+	return 0;
+}
+
+/*****************************************************************************
+ * go_in_history
+ *
+ * Returns nonzero if a position with stone hash <hash> is in the superko
+ * history of <board>.
+ */
+
+int go_in_history(const struct go_board *board, uint64_t hash) {
+	uint64_t word;
+	int i, n;
+
+	word = board->history_bloom[0][BLOOM_WORD(hash)] | board->history_bloom[1][BLOOM_WORD(hash)];
+	if ((word & BLOOM(hash)) != BLOOM(hash)) {
+		return 0;
+	}
+
+	n = (board->history_len < GO_HISTORY) ? board->history_len : GO_HISTORY;
+	for (i = 0; i < n; i++) {
+		if (board->history[i] == hash) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
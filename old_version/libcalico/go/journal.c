@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <calico.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*****************************************************************************
+ * go_new_journal
+ *
+ * Returns a new empty undo journal. Attach it to a board by setting 
+ * board->journal; from then on, every go_place() on that board can be taken
+ * back with go_undo().
+ */
+
+struct go_journal *go_new_journal(void) {
+	return calloc(sizeof(struct go_journal), 1);
+}
+
+/*****************************************************************************
+ * go_free_journal
+ *
+ * Frees <journal> and everything recorded in it. The journal must not be
+ * attached to any board afterwards.
+ */
+
+void go_free_journal(struct go_journal *journal) {
+
+	if (journal) {
+		free(journal->change);
+		free(journal->frame);
+		free(journal);
+	}
+}
+
+/*****************************************************************************
+ * go_save
+ *
+ * Records the current value of the piece at <pos> in the journal of 
+ * <board>, which must have one. Use GO_SAVE() instead, which skips boards
+ * without a journal. Returns zero.
+ */
+
+int go_save(struct go_board *board, int pos) {
+	struct go_journal *journal = board->journal;
+
+	if (journal->changes == journal->change_cap) {
+		journal->change_cap = (journal->change_cap) ? journal->change_cap * 2 : 256;
+		journal->change = realloc(journal->change, 
+			sizeof(struct go_change) * journal->change_cap);
+	}
+
+	journal->change[journal->changes].pos   = pos;
+	journal->change[journal->changes].piece = board->pos[pos];
+	journal->changes++;
+
+	return 0;
+}
+
+/*****************************************************************************
+ * go_frame
+ *
+ * Starts a new frame in the journal of <board>, which must have one, saving
+ * the header fields that a move at <pos> can change. Called by go_place().
+ * Returns zero.
+ */
+
+int go_frame(struct go_board *board, int pos) {
+	struct go_journal *journal = board->journal;
+	struct go_frame *frame;
+
+	if (journal->frames == journal->frame_cap) {
+		journal->frame_cap = (journal->frame_cap) ? journal->frame_cap * 2 : 64;
+		journal->frame = realloc(journal->frame, 
+			sizeof(struct go_frame) * journal->frame_cap);
+	}
+
+	frame = &journal->frame[journal->frames++];
+	frame->changes       = journal->changes;
+	frame->move          = pos;
+	frame->empties       = board->empties;
+	frame->ko            = board->ko;
+	frame->player        = board->player;
+	frame->last          = board->last;
+	frame->llast         = board->llast;
+	frame->hash          = board->hash;
+	frame->history_len   = board->history_len;
+	frame->history_slot  = board->history[board->history_len % GO_HISTORY];
+
+	// the filter generation go_add_history() writes next (see hash.c)
+	memcpy(frame->history_bloom, board->history_bloom[GO_BLOOM_GEN(board->history_len)], 
+		sizeof(frame->history_bloom));
+
+	return 0;
+}
+
+/*****************************************************************************
+ * go_undo
+ *
+ * Takes back the last move recorded in the journal of <board>, restoring 
+ * the board exactly as it was before that go_place(), including the side to
+ * move. Returns zero on success, nonzero if the board has no journal or 
+ * there is nothing to undo.
+ *
+ * This function runs in O(n) time where n is the number of pieces the move
+ * changed.
+ */
+
+int go_undo(struct go_board *board) {
+	struct go_journal *journal = board->journal;
+	struct go_frame *frame;
+	int i, moved;
+
+	if (!journal || journal->frames == 0) {
+		return 1;
+	}
+
+	frame = &journal->frame[--journal->frames];
+
+	for (i = journal->changes - 1; i >= frame->changes; i--) {
+		board->pos[journal->change[i].pos] = journal->change[i].piece;
+	}
+	journal->changes = frame->changes;
+
+	// drop the captured points from the empty list, then put the move back
+	// where it was; the point that was swapped into its slot goes back to
+	// the end, and its index was restored with the pieces above
+	board->empties = frame->empties - 1;
+	i = board->pos[frame->move].index;
+	moved = board->empty[i];
+	board->empty[board->empties++] = moved;
+	board->empty[i] = frame->move;
+
+	board->ko            = frame->ko;
+	board->player        = frame->player;
+	board->last          = frame->last;
+	board->llast         = frame->llast;
+	board->hash          = frame->hash;
+	board->history_len   = frame->history_len;
+	board->history[board->history_len % GO_HISTORY] = frame->history_slot;
+	memcpy(board->history_bloom[GO_BLOOM_GEN(board->history_len)], frame->history_bloom, 
+		sizeof(frame->history_bloom));
+
+	return 0;
+}
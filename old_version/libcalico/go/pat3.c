@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <calico.h>
+
+/*****************************************************************************
+ * 3x3 pattern codes
+ *
+ * The 3x3 pattern code of a point describes its eight neighbors in two bits
+ * each, starting with the neighbor at +1 and going counterclockwise (+1 + 
+ * GO_STRIDE, + GO_STRIDE, -1 + GO_STRIDE, -1, and so on). Each field holds 
+ * the color of the neighbor & 3:
+ *
+ *   EMPTY - 0
+ *   BLACK - 1
+ *   INVAL - 2
+ *   WHITE - 3
+ *
+ * so that swapping the colors of a code only flips the high bit of each
+ * field whose low bit is set (see PAT3_SWAP()).
+ *
+ * With go_set_patterns() enabled, every point on the board keeps its code in
+ * <pat3>: placing or removing a stone only changes the one field that the
+ * stone occupies in each of its eight neighbors' codes, and that field goes
+ * between zero and the stone's color, so go_pat3_flip() toggles it with an 
+ * XOR either way. Changed pieces are saved in the undo journal first.
+ */
+
+static const int pat3_offset[8] = {
+	1, 1 + GO_STRIDE, GO_STRIDE, -1 + GO_STRIDE, 
+	-1, -1 - GO_STRIDE, -GO_STRIDE, 1 - GO_STRIDE
+};
+
+/*****************************************************************************
+ * go_pat3
+ *
+ * Returns the 3x3 pattern code of the position <pos>, computed from scratch.
+ * <pos> must be a position on the board.
+ */
+
+int go_pat3(const struct go_board *board, int pos) {
+	int code, i;
+
+	code = 0;
+	for (i = 0; i < 8; i++) {
+		code |= (board->pos[pos + pat3_offset[i]].color & 3) << (2 * i);
+	}
+
+	return code;
+}
+
+/*****************************************************************************
+ * go_pat3_flip
+ *
+ * Updates the codes of the neighbors of <pos> for a stone of <color> being 
+ * placed on or removed from it. Returns zero.
+ */
+
+int go_pat3_flip(struct go_board *board, int pos, int color) {
+	int i, n;
+
+	for (i = 0; i < 8; i++) {
+		n = pos + pat3_offset[i];
+		GO_SAVE(board, n);
+
+		// seen from the neighbor, <pos> is in the opposite direction
+		board->pos[n].pat3 ^= (color & 3) << (2 * ((i + 4) & 7));
+	}
+
+	return 0;
+}
+
+/*****************************************************************************
+ * go_set_patterns
+ *
+ * Starts (<enable> nonzero) or stops maintaining the 3x3 pattern codes of
+ * <board>. Starting computes every code from scratch. As with 
+ * go_set_tactics(), the setting is not recorded in the undo journal. Returns
+ * zero.
+ */
+
+int go_set_patterns(struct go_board *board, int enable) {
+	int x, y, pos;
+
+	board->patterns = enable;
+
+	if (enable) {
+		for (y = 1; y <= board->dim; y++) {
+			for (x = 1; x <= board->dim; x++) {
+				pos = go_get_pos(x, y);
+				GO_SAVE(board, pos);
+				board->pos[pos].pat3 = go_pat3(board, pos);
+			}
+		}
+	}
+
+	return 0;
+}
@@ -23,12 +23,12 @@ void go_print(struct go_board *board) {
 	const char *letters = " ABCDEFGHJKLMNOPQRST";
 
 	printf("\n    ");
-	for (x = 1; x <= GO_DIM; x++) {
+	for (x = 1; x <= board->dim; x++) {
 		printf("%c ", letters[x]);
 	}
 	printf("\n");
 
-	for (y = GO_DIM; y > 0; y--) {
+	for (y = board->dim; y > 0; y--) {
 		printf(" %2d", y);
 
 		if (board->last == go_get_pos(1, y)) {
@@ -36,7 +36,7 @@ void go_print(struct go_board *board) {
 		}
 		else printf(" ");
 
-		for (x = 1; x <= GO_DIM; x++) {
+		for (x = 1; x <= board->dim; x++) {
 			
 			libs = go_get_libs(board, go_get_pos(x, y));
 			if (go_get_color(board, go_get_pos(x, y)) == WHITE) {
@@ -46,7 +46,7 @@ void go_print(struct go_board *board) {
 				printf("#");	
 			}
 			else {
-				if ((x - 3) % 6 == 1 && (y - 3) % 6 == 1 && (GO_DIM == 13 || GO_DIM == 19)) {
+				if ((x - 3) % 6 == 1 && (y - 3) % 6 == 1 && (board->dim == 13 || board->dim == 19)) {
 					printf("+");
 				}
 				else {
@@ -67,7 +67,7 @@ void go_print(struct go_board *board) {
 	}
 
 	printf("    ");
-	for (x = 1; x <= GO_DIM; x++) {
+	for (x = 1; x <= board->dim; x++) {
 		printf("%c ", letters[x]);
 	}
 	printf("\n\n");
@@ -86,10 +86,10 @@ void go_print_sdl(struct go_board *board, SDL_Surface *surface, SDL_Rect *off) {
 
 	SDL_BlitSurface(board_bmp, NULL, surface, off);
 
-	for (x = 1; x <= GO_DIM; x++) {
-		for (y = 1; y <= GO_DIM; y++) {
+	for (x = 1; x <= board->dim; x++) {
+		for (y = 1; y <= board->dim; y++) {
 			off1.x = off->x + (x - 1) * 23 + 2;
-			off1.y = off->y + (GO_DIM - y) * 23 + 2;
+			off1.y = off->y + (board->dim - y) * 23 + 2;
 			switch (go_get_color(board, go_get_pos(x, y))) {
 			case WHITE: SDL_BlitSurface(white_bmp, NULL, surface, &off1); break;
 			case BLACK: SDL_BlitSurface(black_bmp, NULL, surface, &off1); break;
@@ -18,119 +18,346 @@
 
 #define get_opponent(p) (-(p))
 
+/*****************************************************************************
+ * Neighbor access
+ *
+ * Because the board is surrounded by a border of INVAL positions, the four
+ * neighbors of a position on the board can be found with constant offsets,
+ * and their colors read without any bounds checks.
+ */
+
+#define ADJ(pos) { (pos) + 1, (pos) + GO_STRIDE, (pos) - 1, (pos) - GO_STRIDE }
+#define COLOR(board, p) ((board)->pos[p].color)
+
+/*****************************************************************************
+ * go_place
+ *
+ * Places a stone of color <player> at <pos>, capturing any enemy groups left
+ * without liberties. The move is not checked for legality; use go_check()
+ * first. Returns zero.
+ *
+ * A ko is recorded only when the move captures exactly one stone and leaves
+ * the new stone alone in atari, which is the only case where the opponent 
+ * could immediately retake it.
+ */
+
 int go_place(struct go_board *board, int pos, int player) {
+	const int adj[4] = ADJ(pos);
+	int group[4];
 	int libs;
+	int captured;
+	int ko;
+	int last;
 	int i;
-	int color;
-	int adj[4];
-	
-	board->ko = PASS;
 
-	// reduce liberties of all adjacent groups
-	for (i = 0; i < 4; i++) {
-		adj[i] = go_get_adj(pos, i);
-		go_add_libs(board, adj[i], -1);
+	// the new stone starts as a group of its own, with its empty neighbors as
+	// liberties; captures below add to these
+	for (libs = 0, i = 0; i < 4; i++) {
+		group[i] = go_get_group(board, adj[i]);
+		libs += (COLOR(board, adj[i]) == EMPTY);
 	}
 
-	for (libs = 0, i = 0; i < 4; i++) {
-		color = go_get_color(board, adj[i]);
-		// capture all adjacent enemy groups with no liberties
-		if (color == get_opponent(player)) {
-			if (go_get_libs(board, adj[i]) <= 0) {
-				go_capture_group(board, adj[i]);
-				board->ko = pos;
-				libs++;
-			}
-		}
-		// count liberties of added piece
-		else if (color == EMPTY) {
-			libs++;
-		}
+	if (board->journal) {
+		go_frame(board, pos);
+		go_save(board, pos);
 	}
 
+	// take the point off the empty list by moving the last entry into its
+	// slot
+	last = board->empty[--board->empties];
+	GO_SAVE(board, last);
+	board->pos[last].index = board->pos[pos].index;
+	board->empty[board->pos[pos].index] = last;
+
 	board->pos[pos].libs  = libs;
+	board->pos[pos].size  = 1;
 	board->pos[pos].color = player;
 	board->pos[pos].group = pos;
-	board->pos[pos].rank  = 0;
+	board->pos[pos].next  = pos;
+	board->hash ^= GO_ZOBRIST(player, pos);
+
+	if (board->patterns) {
+		go_pat3_flip(board, pos, player);
+	}
+
+	// the new stone takes a liberty from each distinct adjacent group
+	for (i = 0; i < 4; i++) {
+		if (COLOR(board, adj[i]) != EMPTY && COLOR(board, adj[i]) != INVAL
+				&& (i < 1 || group[i] != group[0]) && (i < 2 || group[i] != group[1])
+				&& (i < 3 || group[i] != group[2])) {
+			GO_SAVE(board, group[i]);
+			board->pos[group[i]].libs--;
+		}
+	}
+
+	// capture all adjacent enemy groups with no liberties
+	ko = PASS;
+	captured = 0;
+	for (i = 0; i < 4; i++) {
+		if (COLOR(board, adj[i]) == get_opponent(player) && go_get_libs(board, adj[i]) == 0) {
+			captured += go_capture_group(board, adj[i]);
+			ko = adj[i];
+		}
+	}
+
+	board->ko = (captured == 1 && board->pos[pos].libs == 1) ? ko : PASS;
 
 	// merge with adjacent allied groups
 	for (i = 0; i < 4; i++) {
-		if (go_get_color(board, adj[i]) == player) {
+		if (COLOR(board, adj[i]) == player) {
 			go_merge_group(board, pos, adj[i]);
 			board->ko = PASS;
 		}
 	}
 
+	// update the atari and two-liberty lists for every group that lost a 
+	// liberty (groups that gained one were updated by go_capture_group())
+	GO_TRACK(board, go_get_group(board, pos), PASS);
+	for (i = 0; i < 4; i++) {
+		if (COLOR(board, adj[i]) == get_opponent(player) && go_get_libs(board, adj[i]) <= 2) {
+			GO_TRACK(board, go_get_group(board, adj[i]), pos);
+		}
+	}
+
 	board->llast = board->last;
 	board->last = pos;
 
+	if (board->superko) {
+		go_add_history(board);
+	}
+
 	return 0;
 }
 
-int go_check(struct go_board *board, int pos, int player) {
-	int i, j;
-	int group;
+/*****************************************************************************
+ * is_suicide
+ *
+ * Returns nonzero if a stone of color <player> at the empty position <pos>
+ * would have no liberties after all captures are made. Since liberty counts
+ * are exact, this only needs to look at the four neighbors.
+ */
+
+static int is_suicide(struct go_board *board, int pos, int player) {
+	const int adj[4] = ADJ(pos);
+	int color;
 	int libs;
+	int i;
 
-	// make sure space is open
-	if (go_get_color(board, pos) != EMPTY) {
-		return 1;
-	}
-	
-	// make sure there are no ko captures
-	if (board->ko && go_get_libs(board, board->ko) == 1){
-		for (i = 0; i < 4; i++) {
-			if (go_get_adj(pos, i) != PASS && go_get_adj(pos, i) == board->ko) {
-				return 1;
-			}
+	for (i = 0; i < 4; i++) {
+		color = COLOR(board, adj[i]);
+		if (color == EMPTY) {
+			return 0;
+		}
+
+		// connecting to a group with another liberty, or capturing a group in
+		// atari, always leaves the stone a liberty
+		libs = go_get_libs(board, adj[i]);
+		if ((color == player && libs > 1) || (color == get_opponent(player) && libs == 1)) {
+			return 0;
 		}
 	}
 
-	// make sure there is no suicide
+	return 1;
+}
+
+/*****************************************************************************
+ * group_hash
+ *
+ * Returns the XOR of the Zobrist keys of all stones in the group led by <g>.
+ */
+
+static uint64_t group_hash(struct go_board *board, int g) {
+	uint64_t hash;
+	int color;
+	int s;
+
+	color = COLOR(board, g);
+	hash = 0;
+
+	s = g;
+	do {
+		hash ^= GO_ZOBRIST(color, s);
+		s = board->pos[s].next;
+	} while (s != g);
+
+	return hash;
+}
+
+/*****************************************************************************
+ * place_hash
+ *
+ * Returns the stone hash (board->hash) that placing a stone of color 
+ * <player> at <pos> would produce, without modifying the board.
+ */
+
+static uint64_t place_hash(struct go_board *board, int pos, int player) {
+	const int adj[4] = ADJ(pos);
+	int group[4];
+	uint64_t hash;
+	int i, j;
+
+	hash = board->hash ^ GO_ZOBRIST(player, pos);
+
 	for (i = 0; i < 4; i++) {
-		libs = 0;
-		group = go_get_group(board, go_get_adj(pos, i));
-		if (go_get_color(board, go_get_adj(pos, i)) == EMPTY) {
-			return 0;
+		group[i] = go_get_group(board, adj[i]);
+	}
+
+	for (i = 0; i < 4; i++) {
+		if (COLOR(board, adj[i]) != get_opponent(player) || board->pos[group[i]].libs != 1) {
+			continue;
 		}
-		for (j = 0; j < 4; j++) {
-			if (go_get_group(board, go_get_adj(pos, j)) == group) {
-				libs++;
-			}
+		// each captured group must only be counted once
+		for (j = 0; j < i; j++) {
+			if (group[j] == group[i]) break;
 		}
-		if (go_get_color(board, go_get_adj(pos, i)) == player) {
-			if (libs != go_get_libs(board, go_get_adj(pos, i))) {
-				return 0;
+		if (j == i) {
+			hash ^= group_hash(board, group[i]);
+		}
+	}
+
+	return hash;
+}
+
+/*****************************************************************************
+ * go_check
+ *
+ * Returns zero if <player> may legally place a stone at <pos>, nonzero if 
+ * not: the position is off the board or occupied, the move retakes a ko, the
+ * move is suicide, or (with superko enabled; see go_set_superko()) the move
+ * repeats an earlier position.
+ */
+
+int go_check(struct go_board *board, int pos, int player) {
+
+	// make sure space is on the board and open (PASS wraps around to a large
+	// unsigned value, and the border is INVAL)
+	if ((unsigned) pos >= (unsigned) GO_LIMIT(board->dim) || COLOR(board, pos) != EMPTY) {
+		return 1;
+	}
+
+	// make sure the ko is not retaken immediately (the player who made the 
+	// capture may still fill it, e.g. after a pass)
+	if (pos == board->ko && player != COLOR(board, board->last)) {
+		return 1;
+	}
+
+	// make sure there is no suicide
+	if (is_suicide(board, pos, player)) {
+		return 1;
+	}
+
+	// make sure no earlier position is repeated
+	if (board->superko && go_in_history(board, place_hash(board, pos, player))) {
+		return 1;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************
+ * go_legal_mask
+ *
+ * Sets the bit of every position where <player> may legally play in <mask>
+ * (GO_MASK_WORDS words; see GO_MASK_TEST()) and clears all other bits. 
+ * Returns the number of legal positions. The result is the same as calling
+ * go_check() on every position, but takes a single pass over the board.
+ *
+ * Notes:
+ *
+ * Since liberty counts are exact, a point is legal if it is empty and has an
+ * empty neighbor, a friendly neighbor with another liberty, or an enemy 
+ * neighbor in atari. Each row is evaluated without branches into a byte per
+ * point and then packed into the mask; the ko point and, with superko 
+ * enabled, repeated positions are removed afterwards.
+ */
+
+#define LIBS(board, p) ((board)->pos[(board)->pos[p].group].libs)
+
+GO_KERNEL int legal_mask_kernel(const int dim, struct go_board *board, int player, uint64_t *mask) {
+	uint8_t legal[GO_STRIDE];
+	int x, y, i, p, count;
+
+	for (i = 0; i < GO_MASK_WORDS; i++) {
+		mask[i] = 0;
+	}
+
+	count = 0;
+	for (y = 1; y <= dim; y++) {
+		const int row = y * GO_STRIDE;
+
+		for (x = 1; x <= dim; x++) {
+			const int pos = row + x;
+			const int adj[4] = ADJ(pos);
+			int ok = 0;
+
+			for (i = 0; i < 4; i++) {
+				const int color = COLOR(board, adj[i]);
+				const int libs  = LIBS(board, adj[i]);
+
+				ok |= (color == EMPTY);
+				ok |= (color == player) & (libs > 1);
+				ok |= (color == get_opponent(player)) & (libs == 1);
 			}
+
+			legal[x] = ok & (COLOR(board, pos) == EMPTY);
 		}
-		else if (go_get_color(board, go_get_adj(pos, i)) == get_opponent(player)) {
-			if (libs >= go_get_libs(board, go_get_adj(pos, i))) {
-				return 0;
+
+		for (x = 1; x <= dim; x++) {
+			mask[(row + x) / 64] |= (uint64_t) legal[x] << ((row + x) % 64);
+			count += legal[x];
+		}
+	}
+
+	// the ko point, unless the player who took the ko is to play
+	p = board->ko;
+	if (p != PASS && player != COLOR(board, board->last) && GO_MASK_TEST(mask, p)) {
+		mask[p / 64] &= ~((uint64_t) 1 << (p % 64));
+		count--;
+	}
+
+	// repeated positions
+	if (board->superko) {
+		for (i = 0; i < board->empties; i++) {
+			p = board->empty[i];
+			if (GO_MASK_TEST(mask, p) && go_in_history(board, place_hash(board, p, player))) {
+				mask[p / 64] &= ~((uint64_t) 1 << (p % 64));
+				count--;
 			}
 		}
 	}
 
-	return 1;
+	return count;
 }
 
-int go_score(struct go_board *board) {
-	int b, w, i, j;
+int go_legal_mask(struct go_board *board, int player, uint64_t *mask) {
+	GO_DISPATCH(board->dim, legal_mask_kernel, board, player, mask);
+}
+
+GO_KERNEL int score_kernel(const int dim, struct go_board *board) {
+	int b, w, x, y, j;
+	int color;
 
 	b = 0;
 	w = 0;
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		switch (go_get_color(board, i)) {
-		case WHITE: w++; break;
-		case BLACK: b++; break;
-		case EMPTY:
-			for (j = 0; j < 4; j++) {
-				if (go_get_color(board, go_get_adj(i, j)) == BLACK) {
-					b++;
-					break;
-				}
-				else if (go_get_color(board, go_get_adj(i, j)) == WHITE) {
-					w++;
-					break;
+	for (y = 1; y <= dim; y++) {
+		for (x = 1; x <= dim; x++) {
+			const int pos = y * GO_STRIDE + x;
+			const int adj[4] = ADJ(pos);
+
+			switch (COLOR(board, pos)) {
+			case WHITE: w++; break;
+			case BLACK: b++; break;
+			case EMPTY:
+				for (j = 0; j < 4; j++) {
+					color = COLOR(board, adj[j]);
+					if (color == BLACK) {
+						b++;
+						break;
+					}
+					else if (color == WHITE) {
+						w++;
+						break;
+					}
 				}
 			}
 		}
@@ -138,3 +365,7 @@ int go_score(struct go_board *board) {
 
 	return (b - w);
 }
+
+int go_score(struct go_board *board) {
+	GO_DISPATCH(board->dim, score_kernel, board);
+}
@@ -20,15 +20,19 @@
 #include <stdint.h>
 
 /*****************************************************************************
- * GO_DIM
+ * GO_MAX_DIM
  *
- * Side length of the Go board. Pretty straightforward. This affects almost
- * all source files.
+ * Largest supported side length of the Go board. The side length of each
+ * board is chosen at runtime (see go_new()), but all board sizes share the
+ * same numbering of positions, which is sized for this maximum. This affects
+ * almost all source files.
  */
 
-#define GO_DIM 9
+#define GO_MAX_DIM 19
 
+#include <rng.h>
 #include <go.h>
+#include <bitboard.h>
 #include <pattern.h>
 #include <playout.h>
 #include <uct.h>
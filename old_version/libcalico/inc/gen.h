@@ -19,9 +19,36 @@
 
 #include <calico.h>
 
+/*****************************************************************************
+ * GEN_LIGHT, GEN_HEAVY, GEN_PATTERN
+ *
+ * Move generation policies (see gen.c): uniformly random moves, moves 
+ * weighted by tactics and locality, and moves weighted by 3x3 pattern.
+ */
+
+#define GEN_LIGHT   0
+#define GEN_HEAVY   1
+#define GEN_PATTERN 2
+
+/*****************************************************************************
+ * struct gen_pattern
+ *
+ * Move weights of the pattern policy, by 3x3 pattern code as seen by BLACK
+ * (see gen_new_pattern()).
+ */
+
+#define GEN_PATTERN_FLOOR (1.0 / 64)
+
+struct gen_pattern {
+	float weight[65536];
+};
+
 /* move generator ***********************************************************/
 
-int gen_move(const struct go_board *board);
-int gen_move_light(const struct go_board *board);
+int gen_move        (const struct go_board *board, struct rng *rng);
+int gen_move_light  (const struct go_board *board, struct rng *rng);
+int gen_move_pattern(const struct go_board *board, struct rng *rng, const struct gen_pattern *pattern);
+
+struct gen_pattern *gen_new_pattern(const struct pat_weight *w);
 
 #endif/*GEN_H*/
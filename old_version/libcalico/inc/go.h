@@ -20,23 +20,196 @@
 #include <SDL/SDL.h>
 #include <stdint.h>
 
+/*****************************************************************************
+ * GO_STRIDE, GO_SIZE, GO_LIMIT
+ *
+ * The board is stored as a "mailbox" array: the playable points are 
+ * surrounded by a one-point border whose color is always INVAL. A position 
+ * on the board is an index into this array, so the four neighbors of any
+ * playable point are simply pos + 1, pos - 1, pos + GO_STRIDE and pos - 
+ * GO_STRIDE, and are always valid indices. This lets the rules code run 
+ * without bounds checks.
+ *
+ * The array is laid out for a board of GO_MAX_DIM, so positions mean the
+ * same thing for every board size; a smaller board simply uses the top-left
+ * corner, and everything else is INVAL. Only the first GO_LIMIT(dim)
+ * positions of a board of side length <dim> are ever read or written.
+ *
+ * Use go_get_pos() to convert from board coordinates to positions.
+ */
+
+#define GO_STRIDE (GO_MAX_DIM + 2)
+#define GO_SIZE   (GO_STRIDE * GO_STRIDE)
+#define GO_LIMIT(dim) (((dim) + 2) * GO_STRIDE)
+
+/*****************************************************************************
+ * GO_KERNEL, GO_DISPATCH
+ *
+ * Loops over the whole board are written once as a GO_KERNEL function that
+ * takes the side length of the board as its first argument, and are then
+ * called through GO_DISPATCH. For the common board sizes (9x9, 13x13 and 
+ * 19x19), GO_DISPATCH calls a copy of the kernel in which the side length is
+ * a compile-time constant, so the loops keep constant bounds and can be 
+ * fully unrolled; any other size falls back to a generic copy.
+ *
+ * GO_DISPATCH returns the kernel's return value from the enclosing function,
+ * so kernels must return a value.
+ */
+
+#define GO_KERNEL static inline __attribute__((always_inline))
+
+#define GO_DISPATCH(dim, kernel, ...) \
+	switch (dim) { \
+	case 9:  return kernel(9,  __VA_ARGS__); \
+	case 13: return kernel(13, __VA_ARGS__); \
+	case 19: return kernel(19, __VA_ARGS__); \
+	default: return kernel(dim, __VA_ARGS__); \
+	}
+
 /* board representation *****************************************************/
 
+// group, next, libs, size, lib, lprev and lnext are described in group.c,
+// and pat3 in pat3.c; index is the position of an empty point in 
+// board->empty
 struct go_piece {
 	int16_t group;
+	int16_t next;
 	int16_t libs;
+	int16_t size;
+	int16_t index;
+	int16_t lib[2];
+	int16_t lprev;
+	int16_t lnext;
+	uint16_t pat3;
 	int8_t color;
-	int8_t rank;
 };
 
+/*****************************************************************************
+ * GO_ATARI, GO_TWO_LIBS
+ *
+ * Heads of the lists of groups with one and two liberties, which are only
+ * maintained when enabled with go_set_tactics(). Each is a border position
+ * whose piece is never part of the board; the leaders of the groups in each
+ * list are linked through <lnext>, and each one holds its liberties in 
+ * <lib>. To visit every group in atari:
+ *
+ *   for (g = board->pos[GO_ATARI].lnext; g != GO_ATARI; g = board->pos[g].lnext)
+ */
+
+#define GO_ATARI    0
+#define GO_TWO_LIBS 1
+
+// calls go_track_group() only for groups that are or will be in a list
+#define GO_TRACK(board, g, hint) \
+	do { \
+		const struct go_piece *_p = &(board)->pos[g]; \
+		if ((board)->tactics && (_p->lnext != PASS || (_p->libs >= 1 && _p->libs <= 2))) \
+			go_track_group((board), (g), (hint)); \
+	} while (0)
+
+/*****************************************************************************
+ * GO_HISTORY
+ *
+ * Number of previous positions remembered for positional superko detection,
+ * when it is enabled with go_set_superko(). Repetitions longer than this are
+ * not detected; in practice, cycles are only a handful of moves long.
+ */
+
+#define GO_HISTORY 32
+
+/*****************************************************************************
+ * GO_BLOOM_WORDS
+ *
+ * Size in 64-bit words of each of the two generations of the Bloom filter 
+ * over the superko history (see hash.c).
+ */
+
+#define GO_BLOOM_WORDS 8
+
+// the filter generation that holds the position numbered <n> in the history
+#define GO_BLOOM_GEN(n) (((n) / GO_HISTORY) & 1)
+
 struct go_board {
-	struct go_piece pos[GO_DIM * GO_DIM];
+	int dim;
+	int ko;
+	int player;
+	int last;
+	int llast;
+
+	// Zobrist hash of the stones on the board (see go_hash())
+	uint64_t hash;
+
+	// positional superko history (see go_set_superko())
+	int superko;
+	int history_len;
+	uint64_t history_bloom[2][GO_BLOOM_WORDS];
+	uint64_t history[GO_HISTORY];
+
+	// atari and two-liberty lists are maintained (see go_set_tactics())
+	int tactics;
+
+	// 3x3 pattern codes are maintained (see go_set_patterns())
+	int patterns;
+
+	// every empty point on the board, in no particular order; go_place() and
+	// go_capture_group() keep this up to date in O(1) time per point, so 
+	// move generators can sample empty points directly
+	int empties;
+	int16_t empty[GO_MAX_DIM * GO_MAX_DIM];
+
+	// undo journal, or NULL if moves are not recorded (see go_undo())
+	struct go_journal *journal;
+
+	// must be last: only the first GO_LIMIT(dim) entries are copied
+	struct go_piece pos[GO_SIZE];
+};
+
+/*****************************************************************************
+ * Undo journal
+ *
+ * A board with a journal records the old value of every piece that 
+ * go_place() changes (including changes made by go_merge_group() and
+ * go_capture_group()), along with the header fields, so that go_undo() can 
+ * take the move back. This lets a search walk a single board down and back
+ * up the tree instead of cloning a board for every node.
+ *
+ * Each go_place() pushes one frame; the changes of a frame are the entries
+ * of <change> from <frame[i].changes> up to the next frame. Both arrays grow
+ * as needed. Boards without a journal pay one branch per piece write.
+ */
+
+struct go_change {
+	int pos;
+	struct go_piece piece;
+};
+
+struct go_frame {
+	int changes;
+	int move;
+	int empties;
 	int ko;
 	int player;
 	int last;
 	int llast;
+	uint64_t hash;
+	int history_len;
+	uint64_t history_bloom[GO_BLOOM_WORDS];
+	uint64_t history_slot;
+};
+
+struct go_journal {
+	struct go_change *change;
+	int changes;
+	int change_cap;
+
+	struct go_frame *frame;
+	int frames;
+	int frame_cap;
 };
 
+#define GO_SAVE(board, p) \
+	do { if ((board)->journal) go_save((board), (p)); } while (0)
+
 /*****************************************************************************
  * Colors
  *
@@ -66,14 +239,15 @@ struct go_board {
  * PASS
  *
  * Represents a universally invalid move. This value is guaranteed to be an
- * integer outside of the range [0, GO_DIM * GO_DIM].
+ * integer outside of the range [0, GO_SIZE).
  */
 
 #define PASS (-1)
 
 /* board operations (board.c) ***********************************************/
-struct go_board *go_new  (void);
+struct go_board *go_new  (int dim);
 struct go_board *go_clone(const struct go_board *board);
+struct go_board *go_copy (struct go_board *dst, const struct go_board *src);
 
 /* basic operations (go.c) **************************************************/
 int    go_get_pos  (int x, int y);
@@ -85,19 +259,55 @@ int go_merge_group  (struct go_board *board, int g1, int g2);
 int go_capture_group(struct go_board *board, int pos);
 int go_get_libs     (struct go_board *board, int pos);
 int go_add_libs     (struct go_board *board, int pos, int value);
+int go_find_libs    (struct go_board *board, int pos, int *libs, int max);
+int go_track_group  (struct go_board *board, int g, int hint);
+int go_set_tactics  (struct go_board *board, int enable);
+
+/* 3x3 pattern codes (pat3.c) **********************************************/
+int go_pat3        (const struct go_board *board, int pos);
+int go_pat3_flip   (struct go_board *board, int pos, int color);
+int go_set_patterns(struct go_board *board, int enable);
 
 /* adjacenct position calculation (adj.c) ***********************************/
 #define ADJ_R 0 // Right
 #define ADJ_U 1	// Up
 #define ADJ_L 2	// Left
 #define ADJ_D 3	// Down
-int go_gen_adj(void);
 int go_get_adj(int pos, int direction);
 
+/* undo journal (journal.c) ************************************************/
+struct go_journal *go_new_journal (void);
+void               go_free_journal(struct go_journal *journal);
+
+int go_save (struct go_board *board, int pos);
+int go_frame(struct go_board *board, int pos);
+int go_undo (struct go_board *board);
+
+/* position hashing (hash.c) ************************************************/
+extern uint64_t go_zobrist[2][GO_SIZE];
+#define GO_ZOBRIST(color, pos) (go_zobrist[(color) == WHITE][pos])
+
+int      go_gen_zobrist (void);
+uint64_t go_hash        (const struct go_board *board);
+int      go_set_superko (struct go_board *board, int enable);
+int      go_add_history (struct go_board *board);
+int      go_in_history  (const struct go_board *board, uint64_t hash);
+
+/*****************************************************************************
+ * GO_MASK_WORDS, GO_MASK_TEST
+ *
+ * A move mask has one bit per position, in GO_MASK_WORDS 64-bit words. 
+ * GO_MASK_TEST() is nonzero if the bit for position <pos> is set.
+ */
+
+#define GO_MASK_WORDS ((GO_SIZE + 63) / 64)
+#define GO_MASK_TEST(mask, pos) (((mask)[(pos) / 64] >> ((pos) % 64)) & 1)
+
 /* rule application (rules.c) ***********************************************/
-int go_place(struct go_board *board, int pos, int player);
-int go_check(struct go_board *board, int pos, int player);
-int go_score(struct go_board *board);
+int go_place     (struct go_board *board, int pos, int player);
+int go_check     (struct go_board *board, int pos, int player);
+int go_legal_mask(struct go_board *board, int player, uint64_t *mask);
+int go_score     (struct go_board *board);
 
 /* output (print.c) *********************************************************/
 void go_print(struct go_board *board);
@@ -105,7 +315,7 @@ void go_print_sdl(struct go_board *board, SDL_Surface *surface, SDL_Rect *off);
 
 /* analysis (analysis.c) ****************************************************/
 int go_dist      (int move0, int move1);
-int go_height    (int move);
+int go_height    (const struct go_board *board, int move);
 int go_is_atari  (struct go_board *board, int move, int player);
 int go_is_extend (struct go_board *board, int move, int player);
 int go_is_capture(struct go_board *board, int move, int player);
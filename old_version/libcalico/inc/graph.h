@@ -30,7 +30,7 @@ struct graph_position {
 #define SYM_CIRCLE	2
 
 struct graph {
-	struct graph_position pos[GO_DIM * GO_DIM];
+	struct graph_position pos[GO_SIZE];
 	SDL_Surface *surface;
 };
 
@@ -39,15 +39,50 @@ void pat_weight_load(struct pat_weight **w, const char *path);
 
 void pat_weight_list(struct pat_weight *w);
 
-/* move distributions *******************************************************/
+/*****************************************************************************
+ * struct mdist
+ *
+ * A move distribution: a weight for every position, stored as the leaves of
+ * a sum tree. Every internal node holds the sum of its two children, so 
+ * setting one weight and drawing a move both take O(log GO_SIZE) time, and
+ * the sums never drift, however many updates are made. Node 1 is the root;
+ * the children of node i are 2i and 2i + 1.
+ *
+ * MDIST_VALUE() reads the weight of a position, and MDIST_TOTAL() the sum 
+ * of all weights. Weights are changed one at a time with mdist_set(), or 
+ * all at once by writing them through MDIST_VALUE() and then calling 
+ * mdist_build(), which takes O(GO_SIZE) time.
+ */
+
+#define MDIST_LEAVES 512 // at least GO_SIZE, and a power of two
 
 struct mdist {
-	double value[GO_DIM * GO_DIM];
-	double total;
+	int dim;
+	double tree[2 * MDIST_LEAVES];
 };
 
-void mdist_add(struct mdist *dest, struct mdist *src, double factor);
-int  mdist_sel(struct mdist *m);
+#define MDIST_VALUE(m, pos) ((m)->tree[MDIST_LEAVES + (pos)])
+#define MDIST_TOTAL(m)      ((m)->tree[1])
+
+/* move distributions (mdist.c) *********************************************/
+void mdist_clear(struct mdist *m, int dim);
+void mdist_build(struct mdist *m);
+void mdist_set  (struct mdist *m, int pos, double value);
+void mdist_add  (struct mdist *dest, struct mdist *src, double factor);
+int  mdist_sel  (struct mdist *m, struct rng *rng);
+
+/*****************************************************************************
+ * PAT3_SWAP
+ *
+ * Swaps the colors of the stones in a 3x3 pattern code (see go/pat3.c): 
+ * BLACK (1) and WHITE (3) fields differ only in their high bit, and are the
+ * only fields with the low bit set.
+ */
+
+#define PAT3_SWAP(code) ((code) ^ (((code) & 0x5555) << 1))
+
+extern uint16_t pat3_canon[65536];
+int pat3_gen_table(void);
 
 /* specific pattern matchers ************************************************/
 
@@ -19,9 +19,117 @@
 
 #include <calico.h>
 
-extern int influence[GO_DIM * GO_DIM];
+/*****************************************************************************
+ * struct ownership
+ *
+ * Sum of the final positions of a thread's playouts (BLACK stones +1, WHITE
+ * stones -1 at each position), written only by that thread; see 
+ * ownership.c. Aligned to a cache line so that the maps of different
+ * threads never share one.
+ */
+
+struct ownership {
+	unsigned int seq;
+	int playouts;
+	int sum[GO_SIZE];
+} __attribute__((aligned(64)));
+
+/*****************************************************************************
+ * PLAYOUT_BATCH
+ *
+ * Maximum number of games that playout_batch() plays out together.
+ */
+
+#define PLAYOUT_BATCH 8
+
+/*****************************************************************************
+ * PLAYOUT_MAX_MOVES, PLAYOUT_MERCY
+ *
+ * Default limits of a new playout context, as percentages of the number of
+ * points on the board: a playout is scored after PLAYOUT_MAX_MOVES moves,
+ * and is won outright by a side that leads by PLAYOUT_MERCY captured stones
+ * (20 on 9x9). Either can be changed per context; zero turns it off.
+ */
+
+#define PLAYOUT_MAX_MOVES 200
+#define PLAYOUT_MERCY     25
+
+/*****************************************************************************
+ * PLAYOUT_RECORD
+ *
+ * Number of moves of each playout that are recorded (see struct 
+ * playout_ctx); enough for a whole playout on the largest board with the 
+ * default move limit.
+ */
+
+#define PLAYOUT_RECORD (PLAYOUT_MAX_MOVES * GO_MAX_DIM * GO_MAX_DIM / 100)
+
+/*****************************************************************************
+ * struct playout_ctx
+ *
+ * Everything one thread needs to run playouts: a scratch board that each 
+ * playout copies its starting position into, the random number generator
+ * state, running statistics, the thread's ownership map and the arena its 
+ * search tree nodes come from. A context is allocated once per thread; 
+ * playouts run in it make no heap allocations at all. A context must not be shared between threads, except for reading its
+ * ownership map with ownership_snapshot().
+ */
+
+struct playout_ctx {
+	struct rng rng;
+
+	// move generation policy (see playout_set_policy())
+	int policy;
+	const struct gen_pattern *pattern;
+
+	// early termination limits (see PLAYOUT_MAX_MOVES)
+	int max_moves;
+	int mercy;
+
+	// RAVE equivalence parameter of uct_playout() (see UCT_RAVE)
+	int rave;
+
+	// statistics
+	long playouts;
+	long moves;
+	long black_wins;
+	long cap_stops;
+	long mercy_stops;
+
+	struct ownership own;
+
+	// search tree nodes, for uct_playout() (see struct uct_arena)
+	struct uct_arena *arena;
+
+	// transposition table shared by the threads searching one tree, or 
+	// NULL (see struct uct_table)
+	struct uct_table *table;
+
+	struct go_board board;
+
+	// starting positions and results of playout_batch()
+	int winner[PLAYOUT_BATCH];
+	struct go_board batch[PLAYOUT_BATCH];
+
+	// the moves of the last playout of each game, in order, as positions 
+	// for BLACK and negated positions for WHITE; passes are left out, and 
+	// only the first PLAYOUT_RECORD moves are kept
+	int record_len[PLAYOUT_BATCH];
+	int16_t record[PLAYOUT_BATCH][PLAYOUT_RECORD];
+};
+
+struct playout_ctx *playout_new_ctx (uint64_t seed, int stream);
+void                playout_free_ctx(struct playout_ctx *ctx);
+
+int playout      (struct playout_ctx *ctx, const struct go_board *board);
+int playout_light(struct playout_ctx *ctx, const struct go_board *board);
+int playout_batch(struct playout_ctx *ctx, int count);
+
+int playout_set_policy(struct playout_ctx *ctx, const char *name);
 
-int playout(const struct go_board *board);
-int playout_light(const struct go_board *board);
+/* ownership statistics (ownership.c) ***************************************/
+int ownership_add     (struct ownership *own, const struct go_board *board);
+int ownership_decay   (struct ownership *own, int divisor);
+int ownership_snapshot(struct playout_ctx *const *ctx, int count, int *map);
 
 #endif/*PLAYOUT_H*/
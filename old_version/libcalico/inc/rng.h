@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*****************************************************************************
+ * struct rng
+ *
+ * State of a xoshiro256** pseudorandom number generator. Generators are 
+ * never shared: each thread or playout context owns one and passes it to 
+ * everything that needs random numbers, so drawing a number touches no 
+ * shared memory and takes no lock. A generator is seeded with rng_seed(), 
+ * and the same seed and stream always produce the same sequence.
+ *
+ * The generator functions are defined here so that they are inlined into
+ * the playout loops.
+ */
+
+struct rng {
+	uint64_t s[4];
+};
+
+/* seeding (rng.c) **********************************************************/
+void rng_seed(struct rng *rng, uint64_t seed, int stream);
+
+/*****************************************************************************
+ * rng_splitmix
+ *
+ * Advances the splitmix64 generator <state> and returns its next 64 bits. 
+ * rng_seed() expands seeds with it, and the Zobrist keys (see hash.c) are
+ * drawn from it, since they need a fixed sequence rather than a generator.
+ */
+
+static inline uint64_t rng_splitmix(uint64_t *state) {
+	uint64_t z;
+
+	z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+	return z ^ (z >> 31);
+}
+
+/*****************************************************************************
+ * rng_next
+ *
+ * Returns the next 64 random bits from <rng>.
+ */
+
+static inline uint64_t rng_next(struct rng *rng) {
+	uint64_t *s = rng->s;
+	uint64_t result, t;
+
+	result = s[1] * 5;
+	result = ((result << 7) | (result >> 57)) * 9;
+
+	t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 45) | (s[3] >> 19);
+
+	return result;
+}
+
+/*****************************************************************************
+ * rng_below
+ *
+ * Returns a random integer in [0, <n>), for 0 < <n> < 2^32. This scales 32
+ * random bits by <n> with a multiplication instead of taking them modulo 
+ * <n>; the bias is below n / 2^32, far too small to matter here.
+ */
+
+static inline int rng_below(struct rng *rng, uint32_t n) {
+	return ((rng_next(rng) >> 32) * n) >> 32;
+}
+
+/*****************************************************************************
+ * rng_float
+ *
+ * Returns a random double in [0, 1), with 53 random bits.
+ */
+
+static inline double rng_float(struct rng *rng) {
+	return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+#endif/*RNG_H*/
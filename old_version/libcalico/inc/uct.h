@@ -19,39 +19,155 @@
 
 #include <calico.h>
 
-struct uct_node {
-	struct go_board *state;
+/*****************************************************************************
+ * struct uct_node
+ *
+ * A node of the search tree, for the position after <move>. Nodes do not 
+ * store positions: uct_playout() walks a single board down the tree with 
+ * go_place() and back up with go_undo().
+ *
+ * <wins> counts the simulations through the node won by the player who 
+ * made <move>. <amaf_plays> and <amaf_wins> count the same for the 
+ * simulations through the parent in which that player played <move> at 
+ * any later point, in the tree or in the playout (see UCT_RAVE). A node's 
+ * children are one contiguous array of <children> nodes, one per legal 
+ * move of its position, which is allocated when the node is first 
+ * descended through; until then <child> is NULL and <expanded> is zero. A
+ * node is 32 bytes, and a node that has only been played out once costs 
+ * nothing more.
+ *
+ * Any number of threads may search one tree at the same time: statistics 
+ * are updated atomically, and children are published without locks (see
+ * uct_expand()). Freeing any part of a tree, by free_uct(), uct_reroot() or
+ * merge_uct(), must wait until no thread is searching it.
+ *
+ * With a transposition table (see struct uct_table), nodes for the same 
+ * position share one array of children, so the tree is really a DAG: a 
+ * node's statistics count the simulations through that move from its
+ * parent, and its children's count those through the position from any
+ * parent.
+ */
 
-	int move;
+struct uct_node {
+	struct uct_node *child;
 	int wins;
 	int plays;
-	int valid;
+	int amaf_wins;
+	int amaf_plays;
+	int16_t move;
+	uint16_t children;
+	uint8_t expanded;
+};
 
-//	int best_child;
+/*****************************************************************************
+ * UCT_MAX_DEPTH
+ *
+ * Deepest node that a descent goes to; a node at this depth is played out 
+ * as if it were a leaf.
+ */
+
+#define UCT_MAX_DEPTH 256
+
+/*****************************************************************************
+ * UCT_RAVE
+ *
+ * Default RAVE equivalence parameter <k> of a playout context. A child that
+ * has been played <n> times is valued as a mix of its own win rate and its
+ * AMAF win rate, with weight beta = sqrt(k / (3n + k)) on the AMAF rate: 
+ * the AMAF statistics, which every simulation updates for many moves at 
+ * once, guide the search while a move has few simulations of its own, and
+ * fade out as it gains them (beta is 1/2 at n = k). Zero turns RAVE off.
+ */
+
+#define UCT_RAVE 1000
 
-	struct uct_node *child[GO_DIM * GO_DIM];
-	struct uct_node *parent;
+/*****************************************************************************
+ * struct uct_arena
+ *
+ * Memory that one thread allocates search tree nodes from; see arena.c. 
+ * <used> is the number of bytes in live nodes, and <reserved> the number 
+ * of bytes taken from the heap, which an arena keeps until it is freed. 
+ * Every playout context has an arena of its own, which uct_playout() in 
+ * that context allocates from.
+ */
+
+#define UCT_SLAB_SIZE    (1 << 20)
+#define UCT_MAX_CHILDREN (GO_MAX_DIM * GO_MAX_DIM)
+
+struct uct_slab;
+
+struct uct_arena {
+	struct uct_slab *slab;
+	struct uct_slab *current;
+	size_t top;
+
+	size_t used;
+	size_t reserved;
+
+	// recycled arrays, by length
+	struct uct_node *free[UCT_MAX_CHILDREN + 1];
+};
+
+/*****************************************************************************
+ * struct uct_table
+ *
+ * Transposition table, which lets nodes for the same position share their
+ * children; see table.c. <entries> is a power of two, in buckets of 
+ * UCT_TABLE_WAYS.
+ */
+
+#define UCT_TABLE_WAYS 4
+
+struct uct_entry {
+	uint64_t tag;
+	struct uct_node *child;
+};
+
+struct uct_table {
+	struct uct_entry *entry;
+	size_t entries;
+	size_t mask;
 };
 
-struct uct_node *new_uct(const struct go_board *state);
-void free_uct(struct uct_node *uct);
+/* node arena (arena.c) *****************************************************/
+struct uct_arena *uct_new_arena  (void);
+void              uct_free_arena (struct uct_arena *arena);
+int               uct_reset_arena(struct uct_arena *arena);
+struct uct_node  *uct_arena_alloc(struct uct_arena *arena, int count);
+int               uct_arena_free (struct uct_node *node, int count);
+
+/* transposition table (table.c) ********************************************/
+struct uct_table *uct_new_table   (int bits);
+void              uct_free_table  (struct uct_table *table);
+int               uct_clear_table (struct uct_table *table);
+struct uct_node  *uct_table_find  (struct uct_table *table, const struct go_board *board, int *count);
+int               uct_table_insert(struct uct_table *table, const struct go_board *board, 
+                                   struct uct_node *child, int count, int depth);
+
+/* search (uct.c) ***********************************************************/
+struct uct_node *new_uct(struct uct_arena *arena);
+int free_uct(struct uct_node *uct);
 struct uct_node *merge_uct(struct uct_node *uct1, struct uct_node *uct2);
+struct uct_node *uct_reroot(struct uct_node *root, int move, struct playout_ctx *ctx);
+
+struct uct_node *uct_child(const struct uct_node *uct, int move);
 
-double uct_ucb(struct uct_node *uct);
-double uct_lcb(struct uct_node *uct);
-double uct_rate(struct uct_node *uct);
+double uct_ucb (const struct uct_node *parent, const struct uct_node *uct, int dim);
+double uct_lcb (const struct uct_node *parent, const struct uct_node *uct, int dim);
+double uct_rate(const struct uct_node *uct);
 
-double uct_rate_rec(struct uct_node *uct, int threshold);
+double uct_rate_rec(const struct uct_node *uct, int threshold);
 
-int uct_best_lcb(struct uct_node *uct);
-int uct_best_ucb(struct uct_node *uct);
-int uct_best_rate(struct uct_node *uct);
-int uct_best_rate_rec(struct uct_node *uct, int threshold);
+int uct_best_lcb     (const struct uct_node *uct, int dim);
+int uct_best_ucb     (const struct uct_node *uct, int dim);
+int uct_best_rate    (const struct uct_node *uct);
+int uct_best_rate_rec(const struct uct_node *uct, int threshold);
 
-double uct_eval_rate(struct uct_node *uct, int move);
+double uct_eval_rate(const struct uct_node *uct, int move);
 
-int uct_playout(struct uct_node *root);
+int uct_playout(struct uct_node *root, struct go_board *board, struct playout_ctx *ctx);
+int uct_playout_batch(struct uct_node *root, struct go_board *board, struct playout_ctx *ctx, int count);
 
-int uct_list(struct uct_node *uct);
+int uct_list(const struct uct_node *uct);
 
 #endif/*UCT_H*/
@@ -19,11 +19,11 @@
 int height_matcher(const struct go_board *board, int move, int player) {
 	int x, y;
 
-	x = (move % GO_DIM) + 1;
-	y = (move / GO_DIM) + 1;
+	x = move % GO_STRIDE;
+	y = move / GO_STRIDE;
 
-	if (x > GO_DIM / 2 + 1) x = GO_DIM - x;
-	if (y > GO_DIM / 2 + 1) y = GO_DIM - y;
+	if (x > board->dim / 2 + 1) x = board->dim - x;
+	if (y > board->dim / 2 + 1) y = board->dim - y;
 
 	return (x < y) ? x : y;
 }
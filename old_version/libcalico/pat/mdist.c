@@ -17,29 +17,96 @@
 #include <calico.h>
 
 #include <stdlib.h>
+#include <string.h>
+
+/*****************************************************************************
+ * mdist_build
+ *
+ * Recomputes every internal node of the sum tree of <m> from the leaves.
+ */
+
+void mdist_build(struct mdist *m) {
+	int i;
+
+	for (i = MDIST_LEAVES - 1; i > 0; i--) {
+		m->tree[i] = m->tree[2 * i] + m->tree[2 * i + 1];
+	}
+}
+
+/*****************************************************************************
+ * mdist_clear
+ *
+ * Makes <m> an empty distribution for a board of side length <dim>.
+ */
+
+void mdist_clear(struct mdist *m, int dim) {
+	memset(m->tree, 0, sizeof(m->tree));
+	m->dim = dim;
+}
+
+/*****************************************************************************
+ * mdist_set
+ *
+ * Sets the weight of <pos> in <m> to <value>, and updates the sums above it.
+ */
+
+void mdist_set(struct mdist *m, int pos, double value) {
+	int i;
+
+	i = MDIST_LEAVES + pos;
+	m->tree[i] = value;
+
+	for (i /= 2; i > 0; i /= 2) {
+		m->tree[i] = m->tree[2 * i] + m->tree[2 * i + 1];
+	}
+}
+
+/*****************************************************************************
+ * mdist_add
+ *
+ * Adds <factor> times each weight of <src> to the same weight of <dest>.
+ */
 
 void mdist_add(struct mdist *dest, struct mdist *src, double factor) {
 	int i;
 
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		dest->value[i] += src->value[i] * factor;
+	for (i = 0; i < GO_LIMIT(src->dim); i++) {
+		MDIST_VALUE(dest, i) += MDIST_VALUE(src, i) * factor;
 	}
 
-	dest->total += src->total * factor;
+	mdist_build(dest);
 }
 
-int mdist_sel(struct mdist *m) {
+/*****************************************************************************
+ * mdist_sel
+ *
+ * Returns a move drawn from <m> with probability proportional to its value,
+ * using the generator <rng>, or PASS if <m> is empty. This walks down the 
+ * sum tree from the root, going left if the remaining draw falls within the
+ * left child's sum, and right otherwise.
+ */
+
+int mdist_sel(struct mdist *m, struct rng *rng) {
 	double r;
 	int i;
 
-	r = (rand() / ((double) RAND_MAX)) * m->total;
+	if (MDIST_TOTAL(m) <= 0.0) {
+		return PASS;
+	}
+
+	r = rng_float(rng) * MDIST_TOTAL(m);
 
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		r -= m->value[i];
-		if (r <= 0.0) {
-			return i;
+	for (i = 1; i < MDIST_LEAVES;) {
+		// rounding may leave r just above the left sum when the right one is
+		// empty; a subtree with no weight is never entered
+		if (r < m->tree[2 * i] || m->tree[2 * i + 1] <= 0.0) {
+			i = 2 * i;
+		}
+		else {
+			r -= m->tree[2 * i];
+			i = 2 * i + 1;
 		}
 	}
 
-	return PASS;
+	return i - MDIST_LEAVES;
 }
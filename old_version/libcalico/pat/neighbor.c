@@ -16,62 +16,84 @@
 
 #include <calico.h>
 
-static int color_code(int color, int player) {
-	
-	if (color == EMPTY) {
-		return 0;
+/*****************************************************************************
+ * pat3_canon
+ *
+ * Canonical form of every 3x3 pattern code (see go/pat3.c): the smallest of
+ * the codes of its four rotations and their mirror images. Two 
+ * neighborhoods that are the same up to symmetry therefore have the same
+ * canonical code. Filled in by pat3_gen_table(), which go_new() calls, so
+ * the table is ready before any search thread starts.
+ */
+
+uint16_t pat3_canon[65536];
+
+// rotates a code a quarter turn: every field moves two places along
+static int pat3_rotate(int code) {
+	return ((code << 4) | (code >> 12)) & 0xFFFF;
+}
+
+// mirrors a code top to bottom: field i moves to field 8 - i
+static int pat3_mirror(int code) {
+	int mirror, i;
+
+	mirror = code & 0x0303;
+	for (i = 1; i < 8; i++) {
+		if (i != 4) {
+			mirror |= ((code >> (2 * i)) & 3) << (2 * (8 - i));
+		}
 	}
-	if (color == INVAL) {
-		return 3;
+
+	return mirror;
+}
+
+int pat3_gen_table(void) {
+	static int done = 0;
+	int code, sym, best, i, j;
+
+	if (done) {
+		return 0;
 	}
-	if (color == player) {
-		return 1;
+
+	for (code = 0; code < 65536; code++) {
+		best = code;
+		for (j = 0; j < 2; j++) {
+			sym = (j) ? pat3_mirror(code) : code;
+			for (i = 0; i < 4; i++) {
+				if (sym < best) {
+					best = sym;
+				}
+				sym = pat3_rotate(sym);
+			}
+		}
+		pat3_canon[code] = best;
 	}
-	
-	return 2;
+
+	done = 1;
+
+	return 0;
 }
 
+/*****************************************************************************
+ * neighbor_matcher
+ *
+ * Returns the canonical 3x3 pattern code of the empty point <pos> as seen 
+ * by <player>, whose stones always count as BLACK, or 0x10000 if <pos> is 
+ * not empty. Uses the board's maintained codes when go_set_patterns() is 
+ * enabled, and reads the eight neighbors otherwise.
+ */
+
 int neighbor_matcher(const struct go_board *board, int pos, int player) {
-	uint16_t rot0, rot1, rot2, rot3;
-	uint16_t adj[8];
-	uint16_t pattern;
-	int x, y;
-	int i;
-	
-	x = (pos % GO_DIM) + 1;
-	y = (pos / GO_DIM) + 1;
-
-	if (go_get_color(board, go_get_pos(x, y)) != EMPTY) {
+	int code;
+
+	if (go_get_color(board, pos) != EMPTY) {
 		return 0x10000;
 	}
 
-	adj[0] = color_code(go_get_color(board, go_get_pos(x+1, y+0)), player);
-	adj[1] = color_code(go_get_color(board, go_get_pos(x+1, y+1)), player);
-	adj[2] = color_code(go_get_color(board, go_get_pos(x+0, y+1)), player);
-	adj[3] = color_code(go_get_color(board, go_get_pos(x-1, y+1)), player);
-	adj[4] = color_code(go_get_color(board, go_get_pos(x-1, y+0)), player);
-	adj[5] = color_code(go_get_color(board, go_get_pos(x-1, y-1)), player);
-	adj[6] = color_code(go_get_color(board, go_get_pos(x+0, y-1)), player);
-	adj[7] = color_code(go_get_color(board, go_get_pos(x+1, y-1)), player);
-
-	pattern = 0;
-	for (i = 0; i < 8; i++) {
-		pattern |= ((adj[i] & 0x3) << (i * 2));
+	code = (board->patterns) ? board->pos[pos].pat3 : go_pat3(board, pos);
+	if (player == WHITE) {
+		code = PAT3_SWAP(code);
 	}
 
-	rot0 = pattern;
-	rot1 = ((pattern >> 4)  | (pattern << 12)) & 0xFFFF;
-	rot2 = ((pattern >> 8)  | (pattern << 8))  & 0xFFFF;
-	rot3 = ((pattern >> 12) | (pattern << 4))  & 0xFFFF;
-
-	if (rot0 < rot1 || rot0 < rot2 || rot0 < rot3) {
-		return rot0;
-	}
-	if (rot1 < rot2 || rot1 < rot3) {
-		return rot1;
-	}
-	if (rot2 < rot3) {
-		return rot2;
-	}
-	return rot3;
+	return pat3_canon[code];
 }
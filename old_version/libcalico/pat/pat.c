@@ -19,25 +19,51 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+static double pat_value(const struct go_board *board, int player, 
+		struct pat_weight *w, pat_matcher p, int pos) {
+	int pattern;
+
+	if (go_get_color(board, pos) == INVAL) {
+		return 0.0;
+	}
+
+	pattern = p(board, pos, player);
+	if (pattern < w->count) {
+		return w->weight[pattern];
+	}
+
+	return 0.0;
+}
+
 struct mdist *pat_gen_mdist(const struct go_board *board, 
 		int player, struct pat_weight *w, pat_matcher p) {
 	struct mdist *m;
-	int i, pattern;
+	int i, pos, code, pattern;
 	
 	m = malloc(sizeof(struct mdist));
-	m->total = 0.0;
-	
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		pattern = p(board, i, player);
-		if (pattern < w->count) {
-			m->value[i] = w->weight[pattern];
-			m->total += m->value[i];
+	mdist_clear(m, board->dim);
+
+	// with maintained 3x3 codes, only empty points have a pattern, and each
+	// weight is a table lookup
+	if (p == neighbor_matcher && board->patterns) {
+		for (i = 0; i < board->empties; i++) {
+			pos = board->empty[i];
+			code = board->pos[pos].pat3;
+			pattern = pat3_canon[(player == WHITE) ? PAT3_SWAP(code) : code];
+			if (pattern < w->count) {
+				MDIST_VALUE(m, pos) = w->weight[pattern];
+			}
 		}
-		else {
-			m->value[i] = 0.0;
+	}
+	else {
+		for (i = 0; i < GO_LIMIT(board->dim); i++) {
+			MDIST_VALUE(m, i) = pat_value(board, player, w, p, i);
 		}
 	}
 
+	// one pass over the tree rather than one walk to the root per point
+	mdist_build(m);
+
 	return m;
 }
 
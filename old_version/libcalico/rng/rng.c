@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <calico.h>
+
+/*****************************************************************************
+ * rng_seed
+ *
+ * Seeds <rng> with stream number <stream> of <seed>. Workers that share a 
+ * seed but use different streams get unrelated sequences, so a whole run is
+ * reproduced by reusing its seed, whatever the number of workers.
+ */
+
+void rng_seed(struct rng *rng, uint64_t seed, int stream) {
+	uint64_t state, mix;
+	int i;
+
+	mix = stream;
+	state = seed ^ rng_splitmix(&mix);
+
+	// splitmix64 never yields four zeros in a row, so the state is never 
+	// all zero, which xoshiro must avoid
+
+	for (i = 0; i < 4; i++) {
+		rng->s[i] = rng_splitmix(&state);
+	}
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <calico.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+/*****************************************************************************
+ * Node arena
+ *
+ * Search trees are built from arrays of nodes (see struct uct_node) that 
+ * are carved out of large slabs, one arena per thread, so expanding a node 
+ * never touches the shared heap. A whole tree is thrown away by resetting
+ * its arena, which takes constant time however large the tree grew; the
+ * slabs are kept, and the next search reuses them.
+ *
+ * Parts of a tree can also be given back early with free_uct(). Their 
+ * arrays go onto free lists by length, and uct_arena_alloc() takes from 
+ * these before it takes new memory from a slab. A free array is linked to
+ * the next through the <child> field of its first node.
+ *
+ * Threads share one tree, so a tree has arrays from many arenas. Every slab
+ * is aligned to its own size and starts with a pointer to its arena, so an
+ * array is always given back to the arena it came from, whoever frees it.
+ */
+
+struct uct_slab {
+	struct uct_slab *next;
+	struct uct_arena *arena;
+	char data[];
+};
+
+#define SLAB_DATA (UCT_SLAB_SIZE - offsetof(struct uct_slab, data))
+
+static struct uct_arena *owner(const struct uct_node *node) {
+	return ((struct uct_slab *) ((uintptr_t) node & ~(uintptr_t) (UCT_SLAB_SIZE - 1)))->arena;
+}
+
+struct uct_arena *uct_new_arena(void) {
+	return calloc(sizeof(struct uct_arena), 1);
+}
+
+void uct_free_arena(struct uct_arena *arena) {
+	struct uct_slab *slab, *next;
+
+	if (!arena) {
+		return;
+	}
+
+	for (slab = arena->slab; slab; slab = next) {
+		next = slab->next;
+		free(slab);
+	}
+
+	free(arena);
+}
+
+/*****************************************************************************
+ * uct_reset_arena
+ *
+ * Frees every node allocated from <arena> at once. The memory stays with 
+ * the arena for the next search. Returns zero.
+ */
+
+int uct_reset_arena(struct uct_arena *arena) {
+
+	arena->current = arena->slab;
+	arena->top = 0;
+	arena->used = 0;
+	memset(arena->free, 0, sizeof(arena->free));
+
+	return 0;
+}
+
+/*****************************************************************************
+ * uct_arena_alloc
+ *
+ * Returns an array of <count> zeroed nodes from <arena>, or NULL if <count>
+ * is zero or no memory is left. <count> is at most UCT_MAX_CHILDREN. Only 
+ * one thread at a time may allocate from or free into an arena.
+ */
+
+struct uct_node *uct_arena_alloc(struct uct_arena *arena, int count) {
+	struct uct_slab *slab;
+	struct uct_node *node;
+	size_t size;
+
+	if (count <= 0 || count > UCT_MAX_CHILDREN) {
+		return NULL;
+	}
+
+	size = count * sizeof(struct uct_node);
+
+	if (arena->free[count]) {
+		// a recycled array of the same length
+		node = arena->free[count];
+		arena->free[count] = node->child;
+	}
+	else {
+		if (!arena->current || arena->top + size > SLAB_DATA) {
+			// move on to the next slab, allocating one if this is the last
+			if (arena->current && arena->current->next) {
+				slab = arena->current->next;
+			}
+			else {
+				if (posix_memalign((void **) &slab, UCT_SLAB_SIZE, UCT_SLAB_SIZE)) {
+					return NULL;
+				}
+				slab->next = NULL;
+				slab->arena = arena;
+
+				if (arena->current) {
+					arena->current->next = slab;
+				}
+				else {
+					arena->slab = slab;
+				}
+				arena->reserved += UCT_SLAB_SIZE;
+			}
+
+			arena->current = slab;
+			arena->top = 0;
+		}
+
+		node = (struct uct_node *) &arena->current->data[arena->top];
+		arena->top += size;
+	}
+
+	arena->used += size;
+	memset(node, 0, size);
+
+	return node;
+}
+
+/*****************************************************************************
+ * uct_arena_free
+ *
+ * Gives the array of <count> nodes at <node>, which must have come from 
+ * uct_arena_alloc(), back to the arena it came from for reuse. Returns 
+ * zero.
+ */
+
+int uct_arena_free(struct uct_node *node, int count) {
+	struct uct_arena *arena;
+
+	if (!node || count <= 0 || count > UCT_MAX_CHILDREN) {
+		return 0;
+	}
+
+	arena = owner(node);
+	node->child = arena->free[count];
+	arena->free[count] = node;
+	arena->used -= count * sizeof(struct uct_node);
+
+	return 0;
+}
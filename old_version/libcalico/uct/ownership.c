@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <calico.h>
+
+#include <string.h>
+
+/*****************************************************************************
+ * Ownership statistics
+ *
+ * Every playout context keeps its own ownership map, so worker threads never
+ * write to shared memory; struct ownership is aligned to a cache line, so 
+ * the maps of different threads never share one either. Readers take 
+ * ownership_snapshot(), which sums the maps of any number of contexts.
+ *
+ * Each map is guarded by a sequence counter that is odd while its writer is
+ * in the middle of an update. A reader copies the map and retries if the
+ * counter was odd or changed in the meantime, so it always sees the map as
+ * of the end of some playout, and the writer never waits for a reader.
+ */
+
+static void write_begin(struct ownership *own) {
+
+	__atomic_store_n(&own->seq, own->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_end(struct ownership *own) {
+	__atomic_store_n(&own->seq, own->seq + 1, __ATOMIC_RELEASE);
+}
+
+/*****************************************************************************
+ * ownership_add
+ *
+ * Adds the final position <board> of a playout to <own>: every black stone
+ * counts +1 and every white stone -1 at its position. Only the thread that 
+ * owns <own> may call this. Returns zero.
+ */
+
+GO_KERNEL int add_kernel(const int dim, struct ownership *own, const struct go_board *board) {
+	int x, y, pos;
+
+	write_begin(own);
+
+	for (y = 1; y <= dim; y++) {
+		for (x = 1; x <= dim; x++) {
+			pos = y * GO_STRIDE + x;
+			__atomic_store_n(&own->sum[pos], own->sum[pos] + board->pos[pos].color, __ATOMIC_RELAXED);
+		}
+	}
+	__atomic_store_n(&own->playouts, own->playouts + 1, __ATOMIC_RELAXED);
+
+	write_end(own);
+
+	return 0;
+}
+
+int ownership_add(struct ownership *own, const struct go_board *board) {
+	GO_DISPATCH(board->dim, add_kernel, own, board);
+}
+
+/*****************************************************************************
+ * ownership_decay
+ *
+ * Divides every entry of <own> by <divisor>, so that old results fade out
+ * instead of being thrown away, e.g. between moves. Only the thread that 
+ * owns <own> may call this. Returns zero.
+ */
+
+int ownership_decay(struct ownership *own, int divisor) {
+	int i;
+
+	write_begin(own);
+
+	for (i = 0; i < GO_SIZE; i++) {
+		__atomic_store_n(&own->sum[i], own->sum[i] / divisor, __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&own->playouts, own->playouts / divisor, __ATOMIC_RELAXED);
+
+	write_end(own);
+
+	return 0;
+}
+
+/*****************************************************************************
+ * ownership_snapshot
+ *
+ * Stores the sum of the ownership maps of the <count> contexts in <ctx> in
+ * <map>, which has GO_SIZE entries: positive values lean black, negative 
+ * values white. Each map is read consistently (see above). May be called 
+ * from any thread while playouts are running. Returns the total number of 
+ * playouts in the maps.
+ */
+
+int ownership_snapshot(struct playout_ctx *const *ctx, int count, int *map) {
+	const struct ownership *own;
+	int copy[GO_SIZE];
+	unsigned int seq;
+	int playouts, total;
+	int i, j;
+
+	memset(map, 0, sizeof(int) * GO_SIZE);
+	total = 0;
+
+	for (i = 0; i < count; i++) {
+		own = &ctx[i]->own;
+
+		do {
+			seq = __atomic_load_n(&own->seq, __ATOMIC_ACQUIRE);
+			for (j = 0; j < GO_SIZE; j++) {
+				copy[j] = __atomic_load_n(&own->sum[j], __ATOMIC_RELAXED);
+			}
+			playouts = __atomic_load_n(&own->playouts, __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		} while ((seq & 1) || seq != __atomic_load_n(&own->seq, __ATOMIC_RELAXED));
+
+		for (j = 0; j < GO_SIZE; j++) {
+			map[j] += copy[j];
+		}
+		total += playouts;
+	}
+
+	return total;
+}
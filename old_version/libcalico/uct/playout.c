@@ -17,78 +17,253 @@
 #include <calico.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
 
-int influence[GO_DIM * GO_DIM];
+/*****************************************************************************
+ * playout_new_ctx, playout_free_ctx
+ *
+ * Allocate and free a playout context (see playout.h). The context's random
+ * number generator is seeded with stream <stream> of <seed> (see rng_seed());
+ * give every thread of a search the same seed and a different stream.
+ */
+
+struct playout_ctx *playout_new_ctx(uint64_t seed, int stream) {
+	struct playout_ctx *ctx;
 
-int playout(const struct go_board *board_init) {
+	// the ownership map must start on its own cache line
+	if (posix_memalign((void **) &ctx, 64, sizeof(struct playout_ctx))) {
+		return NULL;
+	}
+	memset(ctx, 0, sizeof(struct playout_ctx));
+	ctx->arena = uct_new_arena();
+	if (!ctx->arena) {
+		free(ctx);
+		return NULL;
+	}
+	rng_seed(&ctx->rng, seed, stream);
+	ctx->max_moves = PLAYOUT_MAX_MOVES;
+	ctx->mercy = PLAYOUT_MERCY;
+	ctx->policy = GEN_HEAVY;
+	ctx->rave = UCT_RAVE;
+
+	return ctx;
+}
+
+void playout_free_ctx(struct playout_ctx *ctx) {
+	uct_free_arena(ctx->arena);
+	free(ctx);
+}
+
+/*****************************************************************************
+ * PLAYOUT_STOP
+ *
+ * Evaluates to nonzero, and counts the reason in <ctx>, if a playout that 
+ * has made <moves> moves and has a capture lead of <lead> for BLACK should 
+ * stop before two passes: when it reaches <max_moves> moves, in which case
+ * the board is scored as it stands, or when either side leads by <mercy>
+ * captured stones, in which case that side wins. A limit of zero is off.
+ */
+
+#define PLAYOUT_STOP(ctx, moves, lead, max_moves, mercy) \
+	(((mercy) && abs(lead) >= (mercy)) ? ((ctx)->mercy_stops++, 1) : \
+	((max_moves) && (moves) >= (max_moves)) ? ((ctx)->cap_stops++, 1) : 0)
+
+/*****************************************************************************
+ * playout_games
+ *
+ * Plays out the <count> boards in <boards> in place, using the move 
+ * generator of <policy>, and stores the winner of each in the same entry of
+ * <winner>, and its moves in the same entry of <ctx->record>. Each game 
+ * ends at two consecutive passes, or when one of the limits in <ctx> stops
+ * it (see PLAYOUT_STOP). Returns <count>.
+ *
+ * This is the only playout loop: <policy> and <dim> are constants in every
+ * copy of it, so each copy calls its generator directly and carries no 
+ * code for the other policies.
+ *
+ * The games advance in lockstep, one move each per round, and a game that
+ * ends drops out of the round. The games are independent, so the processor
+ * can overlap the cache misses and mispredicted branches of one game with
+ * the work of the others, which a single game's long chain of dependent 
+ * moves does not allow.
+ */
+
+GO_KERNEL int playout_games(const int dim, const int policy, struct playout_ctx *ctx, 
+		struct go_board **boards, int *winner, int count) {
 	struct go_board *board;
-	int move, winner, pass;
+	int8_t pass[PLAYOUT_BATCH];
+	int8_t live[PLAYOUT_BATCH];
+	int moves[PLAYOUT_BATCH];
+	int lead[PLAYOUT_BATCH];
+	int move, lives, empties, max_moves, mercy, i, k;
 
-	board = go_clone(board_init);
-	
-	pass = 0;
-	while (1) {
-		move = gen_move(board);
+	max_moves = ctx->max_moves * dim * dim / 100;
+	mercy = ctx->mercy * dim * dim / 100;
 
-		if (move == PASS) {
-			pass++;
-			board->player = -board->player;
-			if (pass >= 2) {
-				winner = go_score(board);
-				
-				for (int i = 0; i < GO_DIM * GO_DIM; i++) {
-					influence[i] += go_get_color(board, i);
+	for (k = 0; k < count; k++) {
+		pass[k] = 0;
+		live[k] = k;
+		moves[k] = 0;
+		lead[k] = 0;
+	}
+	lives = count;
+
+	while (lives > 0) {
+		for (i = 0; i < lives; i++) {
+			k = live[i];
+			board = boards[k];
+
+			switch (policy) {
+			case GEN_LIGHT:   move = gen_move_light(board, &ctx->rng); break;
+			case GEN_HEAVY:   move = gen_move(board, &ctx->rng); break;
+			case GEN_PATTERN: move = gen_move_pattern(board, &ctx->rng, ctx->pattern); break;
+			}
+
+			if (move == PASS) {
+				pass[k]++;
+				board->player = -board->player;
+				if (pass[k] >= 2) {
+					// the last live game takes this one's place
+					live[i--] = live[--lives];
 				}
 
-				free(board);
-				return (winner > 0) ? BLACK : WHITE;
+				continue;
 			}
 
-			continue;
+			pass[k] = 0;
+			if (moves[k] < PLAYOUT_RECORD) {
+				ctx->record[k][moves[k]] = move * board->player;
+			}
+			empties = board->empties;
+			go_place(board, move, board->player);
+			lead[k] += (board->empties - empties + 1) * board->player;
+			board->player = -board->player;
+			moves[k]++;
+
+			if (PLAYOUT_STOP(ctx, moves[k], lead[k], max_moves, mercy)) {
+				live[i--] = live[--lives];
+			}
 		}
+	}
+
+	for (k = 0; k < count; k++) {
+		board = boards[k];
+		ctx->moves += moves[k];
+		ctx->record_len[k] = (moves[k] < PLAYOUT_RECORD) ? moves[k] : PLAYOUT_RECORD;
+		winner[k] = (mercy && abs(lead[k]) >= mercy) ? ((lead[k] > 0) ? BLACK : WHITE) :
+			(go_score(board) > 0) ? BLACK : WHITE;
+		ownership_add(&ctx->own, board);
 
-		pass = 0;
-		go_place(board, move, board->player);
-		board->player = -board->player;
+		ctx->playouts++;
+		ctx->black_wins += (winner[k] == BLACK);
 	}
 
-	free(board);
-	return 0;
+	return count;
 }
 
-int playout_light(const struct go_board *board_init) {
-	struct go_board *board;
-	int move, winner, pass;
+GO_KERNEL int light_games(const int dim, struct playout_ctx *ctx, struct go_board **boards, int *winner, int count) {
+	return playout_games(dim, GEN_LIGHT, ctx, boards, winner, count);
+}
 
-	board = go_clone(board_init);
-	
-	pass = 0;
-	while (1) {
-		move = gen_move_light(board);
+GO_KERNEL int heavy_games(const int dim, struct playout_ctx *ctx, struct go_board **boards, int *winner, int count) {
+	return playout_games(dim, GEN_HEAVY, ctx, boards, winner, count);
+}
 
-		if (move == PASS) {
-			pass++;
-			board->player = -board->player;
-			if (pass >= 2) {
-				winner = go_score(board);
+GO_KERNEL int pattern_games(const int dim, struct playout_ctx *ctx, struct go_board **boards, int *winner, int count) {
+	return playout_games(dim, GEN_PATTERN, ctx, boards, winner, count);
+}
 
-				for (int i = 0; i < GO_DIM * GO_DIM; i++) {
-					influence[i] += go_get_color(board, i);
-				}
+// the one dispatch on policy and board size per call
+static int run_games(struct playout_ctx *ctx, int policy, struct go_board **boards, int *winner, int count) {
+	const int dim = boards[0]->dim;
 
-				free(board);
-				return (winner > 0) ? BLACK : WHITE;
-			}
+	switch (policy) {
+	case GEN_LIGHT:   GO_DISPATCH(dim, light_games, ctx, boards, winner, count);
+	case GEN_PATTERN: GO_DISPATCH(dim, pattern_games, ctx, boards, winner, count);
+	default:          GO_DISPATCH(dim, heavy_games, ctx, boards, winner, count);
+	}
+}
 
-			continue;
-		}
+/*****************************************************************************
+ * playout, playout_light
+ *
+ * Play a game out from <board> in the scratch board of <ctx> (see 
+ * playout_games()) and return the winner, using the policy of <ctx> or the
+ * light policy. The moves played are left in <ctx->record[0]>. <board> is
+ * not modified.
+ */
+
+int playout(struct playout_ctx *ctx, const struct go_board *board) {
+	struct go_board *boards[1];
+	int winner;
+
+	boards[0] = go_copy(&ctx->board, board);
+	run_games(ctx, ctx->policy, boards, &winner, 1);
+
+	return winner;
+}
+
+int playout_light(struct playout_ctx *ctx, const struct go_board *board) {
+	struct go_board *boards[1];
+	int winner;
+
+	boards[0] = go_copy(&ctx->board, board);
+	run_games(ctx, GEN_LIGHT, boards, &winner, 1);
 
-		pass = 0;
-		go_place(board, move, board->player);
-		board->player = -board->player;
+	return winner;
+}
+
+/*****************************************************************************
+ * playout_batch
+ *
+ * Plays out the first <count> boards of <ctx->batch> in place together (see
+ * playout_games()), using the policy of <ctx>, and stores the winner of 
+ * each in the same entry of <ctx->winner>. <count> is at most 
+ * PLAYOUT_BATCH. Returns <count>.
+ */
+
+int playout_batch(struct playout_ctx *ctx, int count) {
+	struct go_board *boards[PLAYOUT_BATCH];
+	int k;
+
+	for (k = 0; k < count; k++) {
+		boards[k] = &ctx->batch[k];
+	}
+
+	return run_games(ctx, ctx->policy, boards, ctx->winner, count);
+}
+
+/*****************************************************************************
+ * playout_set_policy
+ *
+ * Selects the move generation policy of the playouts of <ctx> by name:
+ * "light", "heavy" (the default) or "pattern" (see gen.c). The pattern 
+ * policy uses the weight table <ctx->pattern>, which must be set first. 
+ * It reads the 3x3 codes of boards that maintain them, and computes them
+ * otherwise, so the board that is searched should have go_set_patterns() 
+ * enabled, for every copy of it to inherit current codes. Returns zero on 
+ * success, nonzero if <name> is not a policy, or is the pattern policy and
+ * <ctx> has no weight table.
+ */
+
+int playout_set_policy(struct playout_ctx *ctx, const char *name) {
+	static const char *const names[] = {
+		[GEN_LIGHT]   = "light",
+		[GEN_HEAVY]   = "heavy",
+		[GEN_PATTERN] = "pattern",
+	};
+	int i;
+
+	for (i = 0; i < (int) (sizeof(names) / sizeof(names[0])); i++) {
+		if (!strcmp(name, names[i])) {
+			if (i == GEN_PATTERN && !ctx->pattern) {
+				return 1;
+			}
+			ctx->policy = i;
+			return 0;
+		}
 	}
 
-	free(board);
-	return 0;
+	return 1;
 }
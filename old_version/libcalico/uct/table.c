@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <calico.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*****************************************************************************
+ * Transposition table
+ *
+ * Maps positions to the child arrays of the search tree, so that every 
+ * node for the same position, however the search reached it, shares one 
+ * array: the tree becomes a DAG, and the statistics of a position's moves 
+ * gather the simulations of all of its move orders.
+ *
+ * The table has a fixed number of buckets of UCT_TABLE_WAYS entries, one 
+ * cache line each. An entry packs the key of its position, a version, the
+ * depth of its position below the root of the search that stored it, and
+ * the length of its array into <tag>, which is zero while the entry is 
+ * free.
+ *
+ * Replacement is depth-preferred: when every entry of a bucket is taken, a
+ * new position replaces the deepest entry, if that is at least as deep as
+ * the new position. Otherwise the new position is not stored, and its node
+ * simply keeps an array of its own. Shallow positions, which gather the 
+ * most simulations, therefore keep their entries. A replaced array stays 
+ * in the tree under the nodes that already share it. uct_reroot() frees 
+ * the entries of positions that the game has left behind.
+ *
+ * A writer claims an entry with a compare-and-swap of <tag> to TAG_BUSY, 
+ * stores <child>, and then publishes the new tag, with the version of the 
+ * old one plus one. A reader loads <tag>, then <child>, then <tag> again, 
+ * and takes the entry only if both tags match; the version makes sure that
+ * an entry that was replaced and then given back to the same position in 
+ * between does not pass. Neither side ever waits.
+ *
+ * The key leaves out the superko history, which would make every move 
+ * order a different position. Arrays in the table therefore hold the moves
+ * that are legal whatever the history, and the search checks the move it 
+ * picks against the history of its own path (see select_child() in 
+ * uct.c).
+ */
+
+// tag layout, from the low bits: length, depth, version, key
+#define LENGTH_BITS  9
+#define DEPTH_BITS   8
+#define VERSION_BITS 8
+#define KEY_SHIFT    (LENGTH_BITS + DEPTH_BITS + VERSION_BITS)
+
+#define LENGTH_MASK  ((1 << LENGTH_BITS) - 1)
+#define DEPTH_MASK   ((1 << DEPTH_BITS) - 1)
+#define VERSION_MASK ((1 << VERSION_BITS) - 1)
+
+#define TAG_LENGTH(tag)  ((int) ((tag) & LENGTH_MASK))
+#define TAG_DEPTH(tag)   ((int) (((tag) >> LENGTH_BITS) & DEPTH_MASK))
+#define TAG_VERSION(tag) ((int) (((tag) >> (LENGTH_BITS + DEPTH_BITS)) & VERSION_MASK))
+#define TAG_KEY(tag)     ((tag) & ~(((uint64_t) 1 << KEY_SHIFT) - 1))
+
+// no array is this long (see UCT_MAX_CHILDREN)
+#define TAG_BUSY LENGTH_MASK
+
+/*****************************************************************************
+ * table_key
+ *
+ * Returns the key of the position <board>: the high bits of its go_hash(),
+ * which covers the stones, the player to move and the ko point, all of 
+ * which change the moves there.
+ */
+
+static uint64_t table_key(const struct go_board *board) {
+	return TAG_KEY(go_hash(board));
+}
+
+static struct uct_entry *table_bucket(struct uct_table *table, uint64_t key) {
+	return &table->entry[((key >> KEY_SHIFT) & table->mask) * UCT_TABLE_WAYS];
+}
+
+/*****************************************************************************
+ * uct_new_table, uct_free_table
+ *
+ * Allocate and free a transposition table of 2^<bits> entries, which takes
+ * 2^<bits> * 16 bytes. A table is shared by every thread that searches the
+ * same tree; set <table> of each thread's playout context to it.
+ */
+
+struct uct_table *uct_new_table(int bits) {
+	struct uct_table *table;
+	size_t size;
+
+	if (bits < 2 || bits > 40) {
+		return NULL;
+	}
+
+	table = malloc(sizeof(struct uct_table));
+	if (!table) {
+		return NULL;
+	}
+
+	size = ((size_t) 1 << bits) * sizeof(struct uct_entry);
+	if (posix_memalign((void **) &table->entry, 64, size)) {
+		free(table);
+		return NULL;
+	}
+	memset(table->entry, 0, size);
+
+	table->entries = (size_t) 1 << bits;
+	table->mask = table->entries / UCT_TABLE_WAYS - 1;
+
+	return table;
+}
+
+void uct_free_table(struct uct_table *table) {
+
+	if (table) {
+		free(table->entry);
+		free(table);
+	}
+}
+
+/*****************************************************************************
+ * uct_clear_table
+ *
+ * Removes every entry from <table>. No thread may be using it. Returns 
+ * zero.
+ */
+
+int uct_clear_table(struct uct_table *table) {
+	memset(table->entry, 0, table->entries * sizeof(struct uct_entry));
+	return 0;
+}
+
+/*****************************************************************************
+ * uct_table_find
+ *
+ * Returns the child array stored for the position <board> in <table>, and
+ * its length in <count>, or NULL if there is none.
+ */
+
+struct uct_node *uct_table_find(struct uct_table *table, const struct go_board *board, int *count) {
+	struct uct_entry *bucket;
+	struct uct_node *child;
+	uint64_t key, tag;
+	int i;
+
+	key = table_key(board);
+	bucket = table_bucket(table, key);
+
+	for (i = 0; i < UCT_TABLE_WAYS; i++) {
+		tag = __atomic_load_n(&bucket[i].tag, __ATOMIC_ACQUIRE);
+		if (!tag || tag == TAG_BUSY || TAG_KEY(tag) != key) {
+			continue;
+		}
+
+		child = __atomic_load_n(&bucket[i].child, __ATOMIC_ACQUIRE);
+		if (child && __atomic_load_n(&bucket[i].tag, __ATOMIC_ACQUIRE) == tag) {
+			*count = TAG_LENGTH(tag);
+			return child;
+		}
+	}
+
+	return NULL;
+}
+
+/*****************************************************************************
+ * uct_table_insert
+ *
+ * Stores the child array <child> of <count> nodes for the position <board>,
+ * <depth> moves below the root of the search, in <table>, replacing a 
+ * deeper entry if its bucket is full. Returns zero on success, nonzero if 
+ * the position is already stored, or every entry of its bucket is taken 
+ * and shallower, or is being written by another thread.
+ */
+
+int uct_table_insert(struct uct_table *table, const struct go_board *board, 
+		struct uct_node *child, int count, int depth) {
+	struct uct_entry *bucket;
+	uint64_t key, tag, old;
+	int i, victim;
+
+	if (!child || count <= 0 || count >= LENGTH_MASK) {
+		return 1;
+	}
+
+	if (depth > DEPTH_MASK) {
+		depth = DEPTH_MASK;
+	}
+
+	key = table_key(board);
+	bucket = table_bucket(table, key);
+
+	// a free entry, or else the deepest one
+	victim = -1;
+	old = 0;
+	for (i = 0; i < UCT_TABLE_WAYS; i++) {
+		tag = __atomic_load_n(&bucket[i].tag, __ATOMIC_ACQUIRE);
+
+		if (!tag) {
+			victim = i;
+			old = 0;
+			break;
+		}
+
+		if (tag == TAG_BUSY) {
+			continue;
+		}
+
+		if (TAG_KEY(tag) == key) {
+			return 1;
+		}
+
+		if (TAG_DEPTH(tag) >= depth && (victim < 0 || TAG_DEPTH(tag) > TAG_DEPTH(old))) {
+			victim = i;
+			old = tag;
+		}
+	}
+
+	if (victim < 0 || !__atomic_compare_exchange_n(&bucket[victim].tag, &old, TAG_BUSY, 0, 
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		return 1;
+	}
+
+	tag = key | (uint64_t) ((TAG_VERSION(old) + 1) & VERSION_MASK) << (LENGTH_BITS + DEPTH_BITS)
+		| (uint64_t) depth << LENGTH_BITS | count;
+
+	__atomic_store_n(&bucket[victim].child, child, __ATOMIC_RELEASE);
+	__atomic_store_n(&bucket[victim].tag, tag, __ATOMIC_RELEASE);
+
+	return 0;
+}
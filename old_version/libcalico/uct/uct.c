@@ -17,298 +17,818 @@
 #include <calico.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
 #include <math.h>
 
-#define N (GO_DIM * GO_DIM)
 #define CONF .5
 
-#define ERR(s, n) (CONF * (log((s) + 1) / log(N)) * sqrt(1.0 / (n)))
+#define ERR(s, n, dim) (CONF * (log((s) + 1) / log((dim) * (dim))) * sqrt(1.0 / (n)))
 
-struct uct_node *new_uct(const struct go_board *state) {
-	struct uct_node *node;
+// statistics may be updated by other threads at any time (see struct 
+// uct_node); relaxed atomics cost nothing extra on x86
+#define LOAD(x)   __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define ADD(x, n) __atomic_fetch_add(&(x), (n), __ATOMIC_RELAXED)
 
-	node = calloc(sizeof(struct uct_node), 1);
-	node->state = go_clone(state);
+// children may be published by another thread at any time (see 
+// uct_expand()); readers load the count first and then the array, both 
+// with acquire order, so a nonzero count always comes with its array
+#define CHILDREN(node) __atomic_load_n(&(node)->children, __ATOMIC_ACQUIRE)
+#define CHILD(node)    __atomic_load_n(&(node)->child, __ATOMIC_ACQUIRE)
 
-	return node;
+/*****************************************************************************
+ * new_uct
+ *
+ * Returns a new root node from <arena>, for any position. Each thread that
+ * searches the tree adds nodes to it from the arena of the playout context
+ * it gives uct_playout().
+ */
+
+struct uct_node *new_uct(struct uct_arena *arena) {
+	return uct_arena_alloc(arena, 1);
 }
 
-void free_uct(struct uct_node *uct) {
+/*****************************************************************************
+ * merge_uct
+ *
+ * Adds the statistics of the tree <uct2> into <uct1>, which must be for the
+ * same position, and frees <uct2>, which must be a root from new_uct() or
+ * uct_reroot(). Returns <uct1>.
+ *
+ * Both trees list the children of a position in the same order (that of 
+ * go_legal_mask()), so children are merged pairwise; where only <uct2> has
+ * expanded a node, its children are moved over as they are and unlinked 
+ * from <uct2>, so that every array ends up either in <uct1> or freed. 
+ * <uct1> may therefore point into the arenas of <uct2>, which must not be
+ * reset while <uct1> is in use. Trees that share arrays through a 
+ * transposition table cannot be merged.
+ */
+
+static void merge_node(struct uct_node *uct1, struct uct_node *uct2) {
 	int i;
 
-	free(uct->state);
-	
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		if (uct->child[i]) {
-			free_uct(uct->child[i]);
-		}
+	uct1->wins += uct2->wins;
+	uct1->plays += uct2->plays;
+	uct1->amaf_wins += uct2->amaf_wins;
+	uct1->amaf_plays += uct2->amaf_plays;
+
+	if (!uct2->expanded) {
+		return;
+	}
+
+	if (!uct1->expanded) {
+		uct1->child = uct2->child;
+		uct1->children = uct2->children;
+		uct1->expanded = 1;
+
+		uct2->child = NULL;
+		uct2->children = 0;
+		uct2->expanded = 0;
+		return;
 	}
 
-	free(uct);
+	for (i = 0; i < uct1->children; i++) {
+		merge_node(&uct1->child[i], &uct2->child[i]);
+	}
+
+	uct_arena_free(uct2->child, uct2->children);
 }
 
 struct uct_node *merge_uct(struct uct_node *uct1, struct uct_node *uct2) {
+
+	merge_node(uct1, uct2);
+	uct_arena_free(uct2, 1);
+
+	return uct1;
+}
+
+/*****************************************************************************
+ * Freeing the DAG
+ *
+ * With a transposition table, one array of children can hang under many 
+ * nodes, so trees are freed by marking: MARK_LIVE marks arrays that are 
+ * still in use, and MARK_SEEN arrays that are being freed. Marks are kept
+ * in <expanded> of the first node of each array, and never outlast the 
+ * call that sets them (MARK_SEEN stays on freed arrays, until they are 
+ * allocated again).
+ */
+
+#define MARK_LIVE 2
+#define MARK_SEEN 4
+
+static void mark(struct uct_node *uct) {
 	int i;
-	
-	uct1->wins += uct2->wins;
-	uct1->plays += uct2->plays;
 
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		if (uct2->child[i]) {
-			if (uct1->child[i]) {
-				merge_uct(uct1->child[i], uct2->child[i]);
-			}
-			else {
-				uct1->child[i] = uct2->child[i];
-			}
-		}
+	if (uct->children == 0 || (uct->child[0].expanded & MARK_LIVE)) {
+		return;
+	}
+
+	uct->child[0].expanded |= MARK_LIVE;
+	for (i = 0; i < uct->children; i++) {
+		mark(&uct->child[i]);
 	}
+}
 
-	free(uct2);
+static void unmark(struct uct_node *uct) {
+	int i;
 
-	return uct1;
+	if (uct->children == 0 || !(uct->child[0].expanded & MARK_LIVE)) {
+		return;
+	}
+
+	uct->child[0].expanded &= ~MARK_LIVE;
+	for (i = 0; i < uct->children; i++) {
+		unmark(&uct->child[i]);
+	}
+}
+
+// frees every array under <uct> that is not marked live; nothing under a
+// live array can be freed, so those are not descended into
+static void sweep(struct uct_node *uct) {
+	struct uct_node *child;
+	int i, n;
+
+	child = uct->child;
+	n = uct->children;
+
+	if (n == 0 || (child[0].expanded & (MARK_LIVE | MARK_SEEN))) {
+		return;
+	}
+
+	child[0].expanded |= MARK_SEEN;
+	for (i = 0; i < n; i++) {
+		sweep(&child[i]);
+	}
+
+	uct_arena_free(child, n);
 }
 
-double uct_ucb(struct uct_node *uct) {
-	double ucb;
+/*****************************************************************************
+ * free_uct
+ *
+ * Gives the child arrays of every node under <uct> back to their arenas 
+ * for reuse, and marks <uct> as not expanded. <uct> itself is part of its 
+ * parent's array (or of its own one-node array, if it is a root from 
+ * new_uct()) and is not freed. No thread may be searching the tree, and no
+ * other part of the DAG may share the arrays; clear any transposition 
+ * table that refers to them. Returns zero.
+ */
+
+int free_uct(struct uct_node *uct) {
 
 	if (!uct) {
-		return 2.0;
+		return 0;
+	}
+
+	sweep(uct);
+
+	uct->child = NULL;
+	uct->children = 0;
+	uct->expanded = 0;
+
+	return 0;
+}
+
+/*****************************************************************************
+ * uct_reroot
+ *
+ * Returns the root of the tree for the position after <move> is played in
+ * the position of <root>, keeping the statistics of the subtree under 
+ * <move>. The new root comes from the arena of <ctx>, and everything that 
+ * the new root cannot reach is given back to the arenas it came from, and 
+ * dropped from the transposition table of <ctx>, if it has one. <root> 
+ * must have come from new_uct() or uct_reroot(), and must not be used 
+ * again. If the tree has no node for <move>, the new root is empty. Returns
+ * NULL if no memory is left.
+ *
+ * Calling this once for each move played, by either side, lets the next 
+ * search start from the simulations of the last one.
+ */
+
+struct uct_node *uct_reroot(struct uct_node *root, int move, struct playout_ctx *ctx) {
+	struct uct_table *table;
+	struct uct_node *child;
+	struct uct_node *new;
+	size_t i;
+
+	new = uct_arena_alloc(ctx->arena, 1);
+	if (!new) {
+		return NULL;
 	}
 
-	if (!uct->valid) {
-		return -1.0;
+	child = (root) ? uct_child(root, move) : NULL;
+	if (child) {
+		*new = *child;
 	}
 
-	if (uct->plays == 0) {
-		return 2.0;
+	if (root) {
+		mark(new);
+
+		table = ctx->table;
+		for (i = 0; table && i < table->entries; i++) {
+			child = table->entry[i].child;
+			if (child && !(child[0].expanded & MARK_LIVE)) {
+				table->entry[i].child = NULL;
+				table->entry[i].tag = 0;
+			}
+		}
+
+		sweep(root);
+		uct_arena_free(root, 1);
+
+		unmark(new);
 	}
 
-	ucb = ((double) (uct->wins) / (uct->plays)) + ERR(uct->parent->plays, uct->plays);
+	return new;
+}
 
-	return (ucb > 1.0) ? 1.0 : ucb;
+/*****************************************************************************
+ * uct_child
+ *
+ * Returns the child of <uct> for <move>, or NULL if <move> is illegal or 
+ * <uct> has not been expanded. Safe to call while another thread expands
+ * <uct>.
+ */
+
+struct uct_node *uct_child(const struct uct_node *uct, int move) {
+	struct uct_node *child;
+	int i, n;
+
+	n = CHILDREN(uct);
+	child = CHILD(uct);
+
+	for (i = 0; i < n; i++) {
+		if (child[i].move == move) {
+			return &child[i];
+		}
+	}
+
+	return NULL;
 }
 
-double uct_lcb(struct uct_node *uct) {
-	double lcb;
+// UCB of <uct> for a parent with <parent_plays> plays, with its win rate 
+// mixed with its AMAF win rate for a RAVE equivalence parameter of <rave> 
+// (see UCT_RAVE); the parent's count is loaded once by the caller, so that
+// its logarithm is computed once per scan
+static inline double child_ucb(const struct uct_node *uct, int parent_plays, int dim, int rave) {
+	double ucb, rate, beta;
+	int plays, amaf_plays;
 
-	if (!uct || uct->plays == 0) {
-		return 0.0;
+	plays = LOAD(uct->plays);
+	amaf_plays = (rave) ? LOAD(uct->amaf_plays) : 0;
+
+	if (plays == 0) {
+		// every child is tried once first, best AMAF win rate first
+		return 1.0 + ((amaf_plays) ? (double) LOAD(uct->amaf_wins) / amaf_plays : 0.5);
 	}
 
-	if (!uct->valid) {
-		return -1.0;
+	rate = (double) LOAD(uct->wins) / plays;
+	if (amaf_plays) {
+		beta = sqrt(rave / (3.0 * plays + rave));
+		rate = (1.0 - beta) * rate + beta * ((double) LOAD(uct->amaf_wins) / amaf_plays);
 	}
 
-	lcb = ((double) (uct->wins) / (uct->plays)) - ERR(uct->parent->plays, uct->plays);
+	ucb = rate + ERR(parent_plays, plays, dim);
 
-	return (lcb < 0.0) ? 0.0 : lcb;
+	return (ucb > 1.0) ? 1.0 : ucb;
+}
+
+double uct_ucb(const struct uct_node *parent, const struct uct_node *uct, int dim) {
+	return child_ucb(uct, LOAD(parent->plays), dim, 0);
 }
 
-double uct_rate(struct uct_node *uct) {
+double uct_lcb(const struct uct_node *parent, const struct uct_node *uct, int dim) {
+	double lcb;
+	int plays;
 
-	if (!uct || uct->plays == 0) {
+	plays = LOAD(uct->plays);
+	if (plays == 0) {
 		return 0.0;
 	}
 
-	if (!uct->valid) {
-		return -1.0;
-	}
+	lcb = ((double) LOAD(uct->wins) / plays) - ERR(LOAD(parent->plays), plays, dim);
 
-	return ((double) (uct->wins) / (uct->plays));
+	return (lcb < 0.0) ? 0.0 : lcb;
 }
 
-double uct_rate_rec(struct uct_node *uct, int threshold) {
-	double rate;
-	
-	if (!uct || uct->plays == 0) {
+double uct_rate(const struct uct_node *uct) {
+	int plays;
+
+	plays = (uct) ? LOAD(uct->plays) : 0;
+	if (plays == 0) {
 		return 0.0;
 	}
 
-	if (!uct->valid) {
-		return -1.0;
+	return ((double) LOAD(uct->wins) / plays);
+}
+
+// with a transposition table, the best line can run around a cycle of 
+// positions, so it is followed at most UCT_MAX_DEPTH moves deep
+static double rate_rec(const struct uct_node *uct, int threshold, int depth) {
+	
+	if (!uct || LOAD(uct->plays) == 0) {
+		return 0.0;
 	}
 
-	if (uct->plays < threshold) {
+	if (LOAD(uct->plays) < threshold || CHILDREN(uct) == 0 || depth >= UCT_MAX_DEPTH) {
 		return uct_rate(uct);
 	}
 	else {
-		rate = uct_rate_rec(uct->child[uct_best_rate(uct)], threshold);
-		if (rate == -1.0) {
-			return uct_rate(uct);
-		}
-		else {
-			return (1.0 - rate);
-		}
+		return (1.0 - rate_rec(uct_child(uct, uct_best_rate(uct)), threshold, depth + 1));
 	}
 }
 
-int uct_best_lcb(struct uct_node *uct) {
+double uct_rate_rec(const struct uct_node *uct, int threshold) {
+	return rate_rec(uct, threshold, 0);
+}
+
+int uct_best_lcb(const struct uct_node *uct, int dim) {
+	const struct uct_node *child;
 	double best_lcb;
 	int best_move;
-	int i;
+	int i, n;
+
+	n = CHILDREN(uct);
+	child = CHILD(uct);
 
 	best_lcb  = -1.0;
-	best_move = -1;
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		if (uct_lcb(uct->child[i]) >= best_lcb) {
-			best_move = i;
-			best_lcb  = uct_lcb(uct->child[i]);
+	best_move = PASS;
+	for (i = 0; i < n; i++) {
+		if (uct_lcb(uct, &child[i], dim) >= best_lcb) {
+			best_move = child[i].move;
+			best_lcb  = uct_lcb(uct, &child[i], dim);
 		}
 	}
 
 	return best_move;
 }
 
-int uct_best_ucb(struct uct_node *uct) {
-	double best_ucb;
-	int best_move;
-	int i;
+/*****************************************************************************
+ * best_ucb
+ *
+ * Returns the index of the child of <uct> with the highest UCB, with RAVE
+ * equivalence parameter <rave>, leaving out the moves set in <skip> if it 
+ * is not NULL, or -1 if no child is left. The children are one dense 
+ * array, so this is a single linear scan.
+ */
+
+GO_KERNEL int best_ucb_kernel(const int dim, const struct uct_node *uct, int rave, const uint64_t *skip) {
+	const struct uct_node *child;
+	double best_ucb, ucb;
+	int best, i, n, plays;
+
+	n = CHILDREN(uct);
+	child = CHILD(uct);
+	plays = LOAD(uct->plays);
+
+	best_ucb = -1.0;
+	best = -1;
+	for (i = 0; i < n; i++) {
+		if (skip && GO_MASK_TEST(skip, child[i].move)) {
+			continue;
+		}
 
-	best_ucb  = -1.0;
-	best_move = -1;
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		if (uct_ucb(uct->child[i]) >= best_ucb) {
-			best_move = i;
-			best_ucb  = uct_ucb(uct->child[i]);
+		ucb = child_ucb(&child[i], plays, dim, rave);
+		if (ucb >= best_ucb) {
+			best = i;
+			best_ucb = ucb;
 		}
 	}
 
-	return best_move;
+	return best;
+}
+
+static int best_ucb(const struct uct_node *uct, int dim, int rave, const uint64_t *skip) {
+	GO_DISPATCH(dim, best_ucb_kernel, uct, rave, skip);
 }
 
-int uct_best_rate(struct uct_node *uct) {
+int uct_best_ucb(const struct uct_node *uct, int dim) {
+	return (CHILDREN(uct)) ? CHILD(uct)[best_ucb(uct, dim, 0, NULL)].move : PASS;
+}
+
+int uct_best_rate(const struct uct_node *uct) {
+	const struct uct_node *child;
 	double best_rate;
 	int best_move;
-	int i;
+	int i, n;
+
+	n = CHILDREN(uct);
+	child = CHILD(uct);
 
 	best_rate = -1.0;
-	best_move = -1;
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		if (uct_rate(uct->child[i]) >= best_rate) {
-			best_move = i;
-			best_rate = uct_rate(uct->child[i]);
+	best_move = PASS;
+	for (i = 0; i < n; i++) {
+		if (uct_rate(&child[i]) >= best_rate) {
+			best_move = child[i].move;
+			best_rate = uct_rate(&child[i]);
 		}
 	}
 
 	return best_move;
 }
 
-int uct_best_rate_rec(struct uct_node *uct, int threshold) {
+int uct_best_rate_rec(const struct uct_node *uct, int threshold) {
+	const struct uct_node *child;
 	double best_rate;
 	int best_move;
-	int i;
+	int i, n;
+
+	n = CHILDREN(uct);
+	child = CHILD(uct);
 
 	best_rate = -1.0;
-	best_move = -1;
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		if (uct_rate_rec(uct->child[i], threshold) >= best_rate && uct->child[i]->plays > threshold) {
-			best_move = i;
-			best_rate = uct_rate_rec(uct->child[i], threshold);
+	best_move = PASS;
+	for (i = 0; i < n; i++) {
+		if (uct_rate_rec(&child[i], threshold) >= best_rate && LOAD(child[i].plays) > threshold) {
+			best_move = child[i].move;
+			best_rate = uct_rate_rec(&child[i], threshold);
 		}
 	}
 
 	return best_move;
 }
 
-static int uct_new_child(struct uct_node *parent, int move) {
-	
-	if (parent->child[move]) {
-		return 1;
+/*****************************************************************************
+ * uct_expand
+ *
+ * Makes sure that <node> has its children. If the transposition table of 
+ * <ctx> has an array for the position <board> (the position of <node>), 
+ * <node> shares it; otherwise the children are allocated from the arena 
+ * of <ctx>, one for each legal move, found with one go_legal_mask() call,
+ * and offered to the table. An array that may be shared is built with 
+ * superko off, so that it holds the same moves whichever path reached the
+ * position; select_child() rejects those that superko forbids. Returns the
+ * number of children, which is zero for a node without legal moves, or for
+ * now if no memory is left or another thread is expanding <node> at the 
+ * same time. <depth> is the depth of <node> below the root of the search.
+ *
+ * Notes:
+ *
+ * Threads that reach a node that has not been expanded at the same time 
+ * each find or build an array of children, and the first to swap its 
+ * array into <child> wins. Only the winner sets <children> and then 
+ * <expanded>; the others give back any array they built and play out from
+ * <node> this time. Readers load <children> or <expanded> first, so a 
+ * thread that sees either also sees the array.
+ */
+
+static int uct_expand(struct uct_node *node, struct go_board *board, struct playout_ctx *ctx, int depth) {
+	uint64_t legal[GO_MASK_WORDS];
+	struct uct_table *table;
+	struct uct_node *child;
+	struct uct_node *old;
+	int shared, superko;
+	int i, n, x, y;
+
+	if (__atomic_load_n(&node->expanded, __ATOMIC_ACQUIRE)) {
+		return CHILDREN(node);
 	}
 
-	parent->child[move] = new_uct(parent->state);
-	parent->child[move]->parent = parent;
+	table = ctx->table;
 
-	if (!go_check(parent->child[move]->state, move, parent->state->player)) {
-		go_place(parent->child[move]->state, move, parent->state->player);
-		parent->child[move]->state->player = -parent->state->player;
-		parent->child[move]->valid = 1;
-		return 0;
+	child = (table) ? uct_table_find(table, board, &n) : NULL;
+	shared = (child != NULL);
+
+	if (!shared) {
+		superko = board->superko;
+		board->superko = (table) ? 0 : superko;
+		go_legal_mask(board, board->player, legal);
+		board->superko = superko;
+
+		n = 0;
+		for (i = 0; i < GO_MASK_WORDS; i++) {
+			n += __builtin_popcountll(legal[i]);
+		}
+
+		child = uct_arena_alloc(ctx->arena, n);
+		if (n && !child) {
+			// out of memory: play out from here until some is freed
+			return 0;
+		}
+
+		n = 0;
+		for (y = 1; child && y <= board->dim; y++) {
+			for (x = 1; x <= board->dim; x++) {
+				i = go_get_pos(x, y);
+				if (GO_MASK_TEST(legal, i)) {
+					child[n++].move = i;
+				}
+			}
+		}
 	}
-	else {
-		parent->child[move]->valid = 0;
+
+	old = NULL;
+	if (child && !__atomic_compare_exchange_n(&node->child, &old, child, 0, 
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		// another thread expanded the node first
+		if (!shared) {
+			uct_arena_free(child, n);
+		}
 		return 0;
 	}
+
+	if (child && !shared && table) {
+		uct_table_insert(table, board, child, n, depth);
+	}
+
+	__atomic_store_n(&node->children, n, __ATOMIC_RELEASE);
+	__atomic_store_n(&node->expanded, 1, __ATOMIC_RELEASE);
+
+	return n;
 }
 
-int uct_playout(struct uct_node *root) {
-	int move;
-	int winner;
+/*****************************************************************************
+ * select_child
+ *
+ * Returns the child of the expanded node <node> with the highest UCB in 
+ * <ctx>, or NULL if none of its moves is legal on <board>, the position of
+ * <node>. With a transposition table, arrays hold moves that superko may 
+ * forbid on this path, or, after a key collision, moves of another 
+ * position (see uct_expand()), so the move chosen is checked with 
+ * go_check(), and the next best child is tried until one passes.
+ */
 
-	if (!root || !root->valid) {
-		return EMPTY;
+static struct uct_node *select_child(struct uct_node *node, struct go_board *board, struct playout_ctx *ctx) {
+	uint64_t skip[GO_MASK_WORDS];
+	struct uct_node *child;
+	int best;
+
+	child = CHILD(node);
+	best = best_ucb(node, board->dim, ctx->rave, NULL);
+
+	if (!ctx->table || !go_check(board, child[best].move, board->player)) {
+		return &child[best];
 	}
 
-	while (1) {
-		// select move to try
-		move = uct_best_ucb(root);
+	memset(skip, 0, sizeof(skip));
+	do {
+		skip[child[best].move / 64] |= (uint64_t) 1 << (child[best].move % 64);
+		best = best_ucb(node, board->dim, ctx->rave, skip);
+	} while (best >= 0 && go_check(board, child[best].move, board->player));
 
-		if (root->child[move]) {
-			// child already exists
+	return (best >= 0) ? &child[best] : NULL;
+}
 
-			if (root->child[move]->valid) {
-				// valid move: recurse
-				winner = uct_playout(root->child[move]);
+/*****************************************************************************
+ * AMAF statistics
+ *
+ * After a simulation, every node on its path updates the AMAF statistics 
+ * of its children (see struct uct_node). The path is walked from the leaf
+ * up, with <first> holding, for each position, the color of the first 
+ * player to play there from the current node on: amaf_start() fills it 
+ * from the playout, and each tree move is added on the way up, so that it
+ * overrides any later move at the same position.
+ */
 
-				if (winner == -root->state->player) {
-					root->wins++;
-				}
-				root->plays++;
+static void amaf_start(int8_t *first, const int16_t *record, int length) {
+	int i, move;
+
+	memset(first, 0, GO_SIZE);
+
+	for (i = length - 1; i >= 0; i--) {
+		move = record[i];
+		first[abs(move)] = (move > 0) ? BLACK : WHITE;
+	}
+}
+
+// counts the simulation for every child of <node> (where <player> is to 
+// move) whose move <player> played first
+static void amaf_update(struct uct_node *node, const int8_t *first, int player, int winner) {
+	struct uct_node *child;
+	int i, n;
+
+	n = CHILDREN(node);
+	child = CHILD(node);
+
+	for (i = 0; i < n; i++) {
+		if (first[child[i].move] == player) {
+			ADD(child[i].amaf_plays, 1);
+			if (winner == player) {
+				ADD(child[i].amaf_wins, 1);
+			}
+		}
+	}
+}
+
+/*****************************************************************************
+ * uct_playout
+ *
+ * Runs one simulation from <root>: descends the tree by UCB, runs a playout
+ * from the first child that has not been played yet, and updates the 
+ * statistics on the way back up. A node is expanded when it is first 
+ * descended through. <board> must be in the position of <root> and have an
+ * undo journal; it is walked down the tree and restored before returning. 
+ * The playout runs in <ctx>, and new nodes come from its arena, or are 
+ * shared through its transposition table. Returns the winner.
+ *
+ * Each node on the way gets its play as the descent passes through it, and
+ * its win, if any, only once the result is known. Until then the play 
+ * counts as a loss (a virtual loss), which steers other threads searching 
+ * the same tree towards other moves. With RAVE on in <ctx>, the AMAF 
+ * statistics of the path are updated as well.
+ */
+
+static int uct_playout_rec(struct uct_node *root, struct go_board *board, struct playout_ctx *ctx, 
+		int depth, int8_t *first) {
+	struct uct_node *child;
+	int player;
+	int winner;
+
+	player = board->player;
+
+	child = NULL;
+	if (depth < UCT_MAX_DEPTH && uct_expand(root, board, ctx, depth)) {
+		child = select_child(root, board, ctx);
+	}
+
+	if (!child) {
+		// too deep, or no legal move: play out from here
+		winner = playout(ctx, board);
+
+		if (ctx->rave) {
+			amaf_start(first, ctx->record[0], ctx->record_len[0]);
+		}
+	}
+	else {
+		go_place(board, child->move, player);
+		board->player = -player;
+
+		if (ADD(child->plays, 1) == 0) {
+			// child has not been tried: playout
+			winner = playout(ctx, board);
 
-				return winner;
+			if (winner == player) {
+				ADD(child->wins, 1);
 			}
-			else {
-				// invalid move: retry
-				continue;
+
+			if (ctx->rave) {
+				amaf_start(first, ctx->record[0], ctx->record_len[0]);
 			}
 		}
 		else {
-			// child does not exist: create
-			uct_new_child(root, move);
-
-			if (root->child[move]->valid) {
-				// valid move: playout
-				
-				winner = playout(root->child[move]->state);
-				
-				if (winner == -root->child[move]->state->player) {
-					root->child[move]->wins++;
-				}
-				root->child[move]->plays++;
+			// child already tried: recurse
+			winner = uct_playout_rec(child, board, ctx, depth + 1, first);
+		}
 
-				if (winner == -root->state->player) {
-					root->wins++;
-				}
-				root->plays++;
-				
-				return winner;
+		go_undo(board);
+
+		if (ctx->rave) {
+			first[child->move] = player;
+			amaf_update(root, first, player, winner);
+		}
+	}
+
+	if (winner == -player) {
+		ADD(root->wins, 1);
+	}
+
+	return winner;
+}
+
+int uct_playout(struct uct_node *root, struct go_board *board, struct playout_ctx *ctx) {
+	int8_t first[GO_SIZE];
+
+	if (!root) {
+		return EMPTY;
+	}
+
+	ADD(root->plays, 1);
+
+	// <first> is filled from the playout wherever the simulation ends
+	return uct_playout_rec(root, board, ctx, 0, first);
+}
+
+/*****************************************************************************
+ * uct_descend
+ *
+ * Walks <board> down the tree from <node> like uct_playout(), stopping at
+ * the first child that has not been played yet or at a node without legal
+ * moves, and copies the position there into <leaf>. <board> is restored 
+ * before returning. Every node on the way, the leaf included, gets its play
+ * (and so a virtual loss) at once. The nodes are stored in <path>, root 
+ * first. Nodes are expanded in <ctx>. Returns the length of the path.
+ */
+
+static int uct_descend(struct uct_node *node, struct go_board *board, struct go_board *leaf, 
+		struct uct_node **path, struct playout_ctx *ctx) {
+	struct uct_node *child;
+	int depth, plays, i;
+
+	depth = 0;
+	while (1) {
+		path[depth] = node;
+		plays = ADD(node->plays, 1);
+
+		if (depth > 0 && plays == 0) {
+			// first play of this node
+			break;
+		}
+
+		if (depth + 1 >= UCT_MAX_DEPTH || uct_expand(node, board, ctx, depth) == 0) {
+			// too deep, or no legal move: play out from here
+			break;
+		}
+
+		child = select_child(node, board, ctx);
+		if (!child) {
+			break;
+		}
+		node = child;
+
+		go_place(board, node->move, board->player);
+		board->player = -board->player;
+		depth++;
+	}
+
+	go_copy(leaf, board);
+
+	for (i = 0; i < depth; i++) {
+		go_undo(board);
+	}
+
+	return depth + 1;
+}
+
+/*****************************************************************************
+ * uct_playout_batch
+ *
+ * Runs <count> simulations from <root> like uct_playout(), but collects all
+ * of their leaves first (see uct_descend()) and then plays them out together
+ * with one playout_batch() in <ctx>. <count> is at most PLAYOUT_BATCH. The
+ * results then replace the virtual losses on the path to each leaf, and 
+ * with RAVE on, update its AMAF statistics. Returns the number of 
+ * simulations run.
+ */
+
+int uct_playout_batch(struct uct_node *root, struct go_board *board, struct playout_ctx *ctx, int count) {
+	struct uct_node *path[PLAYOUT_BATCH][UCT_MAX_DEPTH];
+	int length[PLAYOUT_BATCH];
+	int player[PLAYOUT_BATCH];
+	int8_t first[GO_SIZE];
+	int mover;
+	int i, k;
+
+	if (!root) {
+		return 0;
+	}
+
+	if (count > PLAYOUT_BATCH) {
+		count = PLAYOUT_BATCH;
+	}
+
+	for (k = 0; k < count; k++) {
+		length[k] = uct_descend(root, board, &ctx->batch[k], path[k], ctx);
+
+		// the playouts run in place and leave a different player to move
+		player[k] = ctx->batch[k].player;
+	}
+
+	playout_batch(ctx, count);
+
+	for (k = 0; k < count; k++) {
+		// a node's wins are those of the player who moved into it
+		mover = -player[k];
+
+		if (ctx->rave) {
+			amaf_start(first, ctx->record[k], ctx->record_len[k]);
+		}
+
+		for (i = length[k] - 1; i >= 0; i--) {
+			if (ctx->winner[k] == mover) {
+				ADD(path[k][i]->wins, 1);
 			}
-			else {
-				// invalid move: retry
-				continue;
+
+			// the player to move at this node is the one who did not move
+			// into it
+			if (ctx->rave && i < length[k] - 1) {
+				first[path[k][i + 1]->move] = -mover;
+				amaf_update(path[k][i], first, -mover, ctx->winner[k]);
 			}
+
+			mover = -mover;
 		}
 	}
+
+	return count;
 }
 
-int uct_list(struct uct_node *uct) {
-	int i;
+int uct_list(const struct uct_node *uct) {
+	const struct uct_node *child;
+	int i, n;
 
-	for (i = 0; i < GO_DIM * GO_DIM; i++) {
-		if (uct->child[i] && uct->child[i]->valid) {
-			printf("move %d: ", i);
-			printf("\tplays = %d", (uct->child[i]) ? uct->child[i]->plays : 0);
-			printf("\twins = %d", (uct->child[i]) ? uct->child[i]->wins : 0);
-			printf("\tCI = [%f, %f, %f]\n", 
-				uct_lcb(uct->child[i]), uct_rate(uct->child[i]), uct_ucb(uct->child[i]));
-		}
+	n = CHILDREN(uct);
+	child = CHILD(uct);
+
+	for (i = 0; i < n; i++) {
+		printf("move %d: ", child[i].move);
+		printf("\tplays = %d", LOAD(child[i].plays));
+		printf("\twins = %d", LOAD(child[i].wins));
+		printf("\trate = %f\n", uct_rate(&child[i]));
 	}
 
 	return 0;
 }
 
-double uct_eval_rate(struct uct_node *uct, int move) {
-	return uct_rate(uct->child[move]);
+double uct_eval_rate(const struct uct_node *uct, int move) {
+	return uct_rate(uct_child(uct, move));
 }
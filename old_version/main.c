@@ -28,11 +28,17 @@
 #define TIME_PER_MOVE 10.0
 #define THREADS 4
 
+// transposition table of 2^TABLE_BITS entries, 16 bytes each
+#define TABLE_BITS 20
+
 #define CALICO 0
 #define GEN 1
 #define AI CALICO
 
-struct uct_node *thread_uct[THREADS];
+// search tree and transposition table shared by all threads
+struct uct_node *tree;
+struct uct_table *table;
+struct playout_ctx *thread_ctx[THREADS];
 pthread_t thread[THREADS];
 pthread_t refresh;
 
@@ -71,27 +77,38 @@ int read_move(void) {
 	return go_get_pos(x, y);
 }
 
-void *calico_thread(void *uct_ptr) {
+void *calico_thread(void *ctx_ptr) {
 	struct uct_node *uct;
-	struct uct_node **uct_tbl = uct_ptr;
+	struct go_board *state;
+	struct playout_ctx *ctx;
 	double playout_time;
 	volatile int i;
 
 	playout_time = clock();
 
-	uct = *uct_tbl;
+	uct = tree;
+
+	// each thread walks its own copy of the board down the shared tree
+	state = go_clone(board);
+	state->journal = go_new_journal();
+
+	// and runs its playouts in its own context, which outlives the thread so
+	// that its ownership map can still be drawn and decayed, and its nodes 
+	// stay in the tree
+	ctx = ctx_ptr;
 
 	printf("thread starting on UCT %p\n", (void*) uct);
 
-	for (i = 0; i < PLAYOUTS / THREADS; i++) {
-		uct_playout(uct);
+	for (i = 0; i < PLAYOUTS / THREADS; i += PLAYOUT_BATCH) {
+		uct_playout_batch(uct, state, ctx, PLAYOUT_BATCH);
 
-		if (i % 100 == 0) {
+		if (i % (100 * PLAYOUT_BATCH) == 0) {
 			printf("progress: %f%%\r", 100 * (i / (double) (PLAYOUTS / THREADS)));
 		}
 	}
 
-	*uct_tbl = uct;
+	go_free_journal(state->journal);
+	free(state);
 
 	return NULL;
 }
@@ -99,7 +116,9 @@ void *calico_thread(void *uct_ptr) {
 void *refresh_thread(void *mutex_ptr) {
 	SDL_mutex *mutex = mutex_ptr;
 	struct uct_node *uct;
+	struct uct_node *child;
 	SDL_Rect off1;
+	int ownership[GO_SIZE];
 	uint32_t color;
 	double hue, value, r, g, b;
 	int plays, wins;
@@ -107,17 +126,20 @@ void *refresh_thread(void *mutex_ptr) {
 	int i;
 	
 	while (1) {
+		// a consistent copy, taken without stopping the playouts
+		ownership_snapshot(thread_ctx, THREADS, ownership);
+
 		SDL_mutexP(mutex);
 		// draw influence board
 		SDL_BlitSurface(board_bmp, NULL, screen, &board2_off);
 
-		for (x = 1; x <= GO_DIM; x++) {
-			for (y = 1; y <= GO_DIM; y++) {
+		for (x = 1; x <= board->dim; x++) {
+			for (y = 1; y <= board->dim; y++) {
 				off1.x = board2_off.x + (x - 1) * 23 + 2;
-				off1.y = board2_off.y + (GO_DIM - y) * 23 + 2;
+				off1.y = board2_off.y + (board->dim - y) * 23 + 2;
 				off1.w = 23;
 				off1.h = 23;
-				color = ((atan(influence[go_get_pos(x, y)] / 4000.0) + M_PI_2) / M_PI) * 255;
+				color = ((atan(ownership[go_get_pos(x, y)] / 4000.0) + M_PI_2) / M_PI) * 255;
 				color = 255 - color;
 				color = (color << 16 | color << 8 | color);
 				SDL_FillRect(screen, &off1, color);
@@ -125,25 +147,23 @@ void *refresh_thread(void *mutex_ptr) {
 		}
 
 		// draw winrate board
-		if (thread_uct[0]) {
+		if (tree) {
 		SDL_BlitSurface(board_bmp, NULL, screen, &board3_off);
 
-		uct = thread_uct[0];
-		for (x = 1; x <= GO_DIM; x++) {
-			for (y = 1; y <= GO_DIM; y++) {
+		uct = tree;
+		for (x = 1; x <= board->dim; x++) {
+			for (y = 1; y <= board->dim; y++) {
 				off1.x = board3_off.x + (x - 1) * 23 + 2;
-				off1.y = board3_off.y + (GO_DIM - y) * 23 + 2;
+				off1.y = board3_off.y + (board->dim - y) * 23 + 2;
 				off1.w = 23;
 				off1.h = 23;
 				
 				plays = 0;
 				wins = 0;
-				for (i = 0; i < THREADS; i++) {
-					uct = thread_uct[i];
-					if (uct->child[go_get_pos(x, y)]) {
-						plays += uct->child[go_get_pos(x, y)]->plays;
-						wins += uct->child[go_get_pos(x, y)]->wins;
-					}
+				child = uct_child(uct, go_get_pos(x, y));
+				if (child) {
+					plays = child->plays;
+					wins = child->wins;
 				}
 
 				hue = (double) wins / plays;
@@ -163,7 +183,7 @@ void *refresh_thread(void *mutex_ptr) {
 				color = ((uint32_t) (r * 255)) << 16 | ((uint32_t) (g * 255)) << 8 | ((uint32_t) (b * 255));
 
 
-				if (board && (!thread_uct[0]->child[go_get_pos(x, y)] || thread_uct[0]->child[go_get_pos(x, y)]->valid == 0)) {
+				if (board && !uct_child(uct, go_get_pos(x, y))) {
 					switch (go_get_color(board, go_get_pos(x, y))) {
 					case WHITE: SDL_BlitSurface(white_bmp, NULL, screen, &off1); break;
 					case BLACK: SDL_BlitSurface(black_bmp, NULL, screen, &off1); break;
@@ -184,20 +204,46 @@ void *refresh_thread(void *mutex_ptr) {
 
 }
 
-int main(void) {
+// moves the tree down to the position after <move>, so the next search
+// starts from the simulations already made below it; no thread may be 
+// searching
+
+void reroot(SDL_mutex *mutex, int move) {
+
+	SDL_mutexP(mutex);
+	tree = uct_reroot(tree, move, thread_ctx[0]);
+	SDL_mutexV(mutex);
+}
+
+int main(int argc, char **argv) {
 	SDL_mutex *mutex;
 	double playout_time;
 	int move;
+	int dim;
 
 	#if (AI == CALICO)
-	struct uct_node *uct;
 	double rate;
 	int x, y;
 	int i;
 	int plays;
+	size_t used, reserved;
+	#elif (AI == GEN)
+	struct rng rng;
 	#endif
+	struct pat_weight *weights;
+	struct gen_pattern *pattern;
+	uint64_t seed;
+
+	dim = (argc > 1) ? atoi(argv[1]) : 9;
+	board = go_new(dim);
+	if (!board) {
+		fprintf(stderr, "unsupported board size %d\n", dim);
+		return 1;
+	}
+
+	// the search and playouts inherit this through go_clone()
+	go_set_superko(board, 1);
 
-	board = go_new();
 	mutex = SDL_CreateMutex();
 
 	SDL_Init(SDL_INIT_VIDEO);
@@ -218,28 +264,67 @@ int main(void) {
 
 	SDL_BlitSurface(board_bmp, NULL, screen, &board1_off);
 
+	// a run can be repeated by passing its seed again
+	seed = (argc > 2) ? strtoull(argv[2], NULL, 0) : (uint64_t) time(NULL);
+	printf("seed: %llu\n", (unsigned long long) seed);
+
+	// the pattern policy draws from the neighbor_matcher() weights saved in
+	// the file named after it, shared by all threads
+	pattern = NULL;
+	if (argc > 4) {
+		weights = NULL;
+		pat_weight_load(&weights, argv[4]);
+		if (!weights) {
+			fprintf(stderr, "could not load pattern weights %s\n", argv[4]);
+			return 1;
+		}
+		pattern = gen_new_pattern(weights);
+		free(weights->weight);
+		free(weights);
+	}
+
+	for (i = 0; i < THREADS; i++) {
+		thread_ctx[i] = playout_new_ctx(seed, i);
+		thread_ctx[i]->pattern = pattern;
+		if (argc > 3 && playout_set_policy(thread_ctx[i], argv[3])) {
+			fprintf(stderr, "unknown playout policy %s, or no pattern weights for it\n", argv[3]);
+			return 1;
+		}
+	}
+
+	// every copy of the board that is played out inherits current codes
+	if (pattern) {
+		go_set_patterns(board, 1);
+	}
+
+	// the tree is kept from move to move (see reroot())
+	tree = new_uct(thread_ctx[0]->arena);
+	table = uct_new_table(TABLE_BITS);
+	for (i = 0; i < THREADS; i++) {
+		thread_ctx[i]->table = table;
+	}
+
 	pthread_create(&refresh, NULL, refresh_thread, mutex);
 
-	srand(time(NULL));
+	#if (AI == GEN)
+	rng_seed(&rng, seed, 0);
+	#endif
 	plays = 0;
 
 	while (1) {
 
 		board->player = BLACK;
 
-		for (y = GO_DIM - 1; y >= 0; y--) {
-			for (x = 0; x < GO_DIM; x++) {
-				influence[x + y * GO_DIM] /= 1000;
-			}
+		// no playouts are running, so this is each map's only writer
+		for (i = 0; i < THREADS; i++) {
+			ownership_decay(&thread_ctx[i]->own, 1000);
 		}
 
 		#if (AI == CALICO)
 		playout_time = clock();
 
 		for (i = 0; i < THREADS; i++) {
-			thread_uct[i] = new_uct(board);
-			thread_uct[i]->valid = 1;
-			if (pthread_create(&thread[i], NULL, calico_thread, (void*) &thread_uct[i])) {
+			if (pthread_create(&thread[i], NULL, calico_thread, thread_ctx[i])) {
 				fprintf(stderr, "could not create thread %d\n", i);
 				abort();
 			}
@@ -248,26 +333,26 @@ int main(void) {
 		for (i = 0; i < THREADS; i++) {
 			pthread_join(thread[i], NULL);
 
-//			printf("thread %d terminated with %d playouts\n", i, thread_uct[i]->plays);
+//			printf("thread %d terminated\n", i);
 		}
 
-		SDL_mutexP(mutex);
-		uct = thread_uct[0];
-		for (i = 1; i < THREADS; i++) {
-			merge_uct(uct, thread_uct[i]);
-		}
-		thread_uct[0] = NULL;
-		SDL_mutexV(mutex);
+//		printf("playouts per second: %f\n", plays / ((clock() - playout_time) / CLOCKS_PER_SEC));
 
-//		printf("playouts: %d\n", uct->plays);
-//		printf("playouts per second: %f\n", uct->plays / ((clock() - playout_time) / CLOCKS_PER_SEC));
-//		printf("highest confidence: %f\n", uct_rate(uct->child[uct_best_rate(uct)]));
+		move = uct_best_rate(tree);
 
-		move = uct_best_rate(uct);
+		rate = uct_eval_rate(tree, move);
+//		uct_list(tree);
 
-		rate = uct_eval_rate(uct, move);
-//		uct_list(uct);
-		free_uct(uct);
+		// the playouts include those kept from the previous search, and the
+		// tree has nodes in every thread's arena
+		plays = tree->plays;
+		used = reserved = 0;
+		for (i = 0; i < THREADS; i++) {
+			used += thread_ctx[i]->arena->used;
+			reserved += thread_ctx[i]->arena->reserved;
+		}
+		printf("tree: %d playouts, %zu KB of nodes (%zu KB reserved)\n", 
+			plays, used >> 10, reserved >> 10);
 
 		if (rate < .4) {
 			printf("black's move: resign");
@@ -276,17 +361,17 @@ int main(void) {
 		}
 
 		#elif (AI == GEN)
-		move = gen_move(board);
+		move = gen_move(board, &rng);
 		#endif
 
 //		printf("\n");
 //		printf("influence map:\n");
-//		for (y = GO_DIM - 1; y >= 0; y--) {
-//			for (x = 0; x < GO_DIM; x++) {
-//				if (influence[x + y * GO_DIM] > 1000) {
+//		for (y = board->dim; y > 0; y--) {
+//			for (x = 1; x <= board->dim; x++) {
+//				if (influence[go_get_pos(x, y)] > 1000) {
 //					printf("# ");
 //				}
-//				else if (influence[x + y * GO_DIM] < -1000) {
+//				else if (influence[go_get_pos(x, y)] < -1000) {
 //					printf("O ");
 //				}
 //				else {
@@ -296,9 +381,21 @@ int main(void) {
 //			printf("\n");
 //		}
 
-		go_place(board, move, BLACK);
+		// never play a move unchecked, whatever chose it
+		if (move != PASS && go_check(board, move, BLACK)) {
+			printf("black's move %d is illegal\n", move);
+			move = PASS;
+		}
+
+		if (move != PASS) {
+			go_place(board, move, BLACK);
+		}
 		printf("black's move: %d\n", move);
 
+		#if (AI == CALICO)
+		reroot(mutex, move);
+		#endif
+
 		go_print(board);
 		SDL_mutexP(mutex);
 		go_print_sdl(board, screen, &board1_off);
@@ -315,6 +412,10 @@ int main(void) {
 //			}
 			if (!go_check(board, move, WHITE)) {
 				go_place(board, move, WHITE);
+
+				#if (AI == CALICO)
+				reroot(mutex, move);
+				#endif
 				go_print(board);
 				SDL_mutexP(mutex);
 				go_print_sdl(board, screen, &board1_off);
@@ -0,0 +1,540 @@
+/*
+ * Copyright (C) 2011 Nick Johnson <nickbjohnson4224 at gmail.com>
+ * 
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <calico.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+
+/*****************************************************************************
+ * calico-perft [-d dim] [-n depth] [-s seed] [-p prefix] [-r samples] [-v]
+ *
+ * Counts move sequences with go_check() and go_place(), like perft in chess
+ * engines, as a throughput measure and a correctness check of the rules 
+ * code. The start position is reached by playing <prefix> light-policy 
+ * moves from an empty board with generator seed <seed>. From there, every
+ * sequence of <depth> legal moves is walked with the undo journal, or, with
+ * -r, <samples> sequences of uniformly random legal moves are. Passes are 
+ * not moves here, and superko is off, so only the simple ko rule applies.
+ *
+ * Each depth from 1 to <depth> is walked on its own, as in chess perft, 
+ * and prints one tab-separated line:
+ *
+ *   depth  nodes  captures  hash  seconds  nodes/s
+ *
+ * where <nodes> is the number of positions reached at that depth, 
+ * <captures> the number of stones captured by the moves into them, and 
+ * <hash> the sum of their go_hash() values, which does not depend on the 
+ * order in which they were visited. <seconds> is the time of the walk to 
+ * that depth, and <nodes/s> counts the positions at every depth of it. 
+ * With -r, every depth starts from the same generator state.
+ *
+ * With -v, every position is also checked against a slow reference that 
+ * keeps only the colors of the points and finds groups and liberties by
+ * flood fill: at every node, go_check() and go_legal_mask() must agree 
+ * with it on every point, and after every move, the stones, the ko point 
+ * and every group's liberty count must match. The 3x3 pattern codes and 
+ * the atari and two-liberty lists are also maintained then (see 
+ * go_set_patterns() and go_set_tactics()), and after every move and every
+ * undo, the stone hash must match one recomputed from the stones, each 
+ * code must match go_pat3(), and each list must hold exactly the groups 
+ * with that many liberties, with their liberties. The first few 
+ * differences are printed, and the exit status is nonzero if there were 
+ * any.
+ */
+
+#define MAX_DEPTH 16
+
+struct counts {
+	long nodes;
+	long captures;
+	uint64_t hash;
+};
+
+static struct counts counts[MAX_DEPTH + 1];
+static int verify;
+static long errors;
+
+static double now(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*****************************************************************************
+ * Reference rules
+ *
+ * struct ref holds only what the rules depend on. ref_play() makes a move 
+ * from scratch: it removes every enemy group next to the stone that has no
+ * liberties left, rejects the move if its own group then has none, and 
+ * records a ko when exactly one stone was captured by a single stone left 
+ * with one liberty. The ko may not be retaken by the opponent of the player
+ * who captured it.
+ */
+
+struct ref {
+	int dim;
+	int ko;
+	int last;
+	int8_t color[GO_SIZE];
+};
+
+static const int ref_adj[4] = { 1, GO_STRIDE, -1, -GO_STRIDE };
+
+static void ref_load(struct ref *ref, const struct go_board *board) {
+	int i;
+
+	ref->dim = board->dim;
+	ref->ko = board->ko;
+	ref->last = (board->last == PASS) ? EMPTY : board->pos[board->last].color;
+	for (i = 0; i < GO_SIZE; i++) {
+		ref->color[i] = (i < GO_LIMIT(board->dim)) ? board->pos[i].color : INVAL;
+	}
+}
+
+// marks the group at <pos> in <mark>, stores its stones in <stones>, and
+// returns its number of distinct liberties
+static int ref_group(const struct ref *ref, int pos, uint8_t *mark, int *stones, int *size) {
+	uint8_t seen[GO_SIZE];
+	int stack[GO_SIZE];
+	int top, libs, s, n, i;
+
+	memset(seen, 0, sizeof(seen));
+	memset(mark, 0, GO_SIZE);
+
+	libs = 0;
+	*size = 0;
+	top = 0;
+	stack[top++] = pos;
+	mark[pos] = 1;
+
+	while (top > 0) {
+		s = stack[--top];
+		stones[(*size)++] = s;
+
+		for (i = 0; i < 4; i++) {
+			n = s + ref_adj[i];
+			if (ref->color[n] == EMPTY && !seen[n]) {
+				seen[n] = 1;
+				libs++;
+			}
+			else if (ref->color[n] == ref->color[pos] && !mark[n]) {
+				mark[n] = 1;
+				stack[top++] = n;
+			}
+		}
+	}
+
+	return libs;
+}
+
+// plays <player> at <pos>; returns the number of stones captured, or -1 if
+// the move is illegal, in which case <ref> is unchanged
+static int ref_play(struct ref *ref, int pos, int player) {
+	struct ref old;
+	uint8_t mark[GO_SIZE];
+	int stones[GO_SIZE];
+	int captured, size, single, libs;
+	int i, j, n;
+
+	if (ref->color[pos] != EMPTY) {
+		return -1;
+	}
+	if (pos == ref->ko && player != ref->last) {
+		return -1;
+	}
+
+	old = *ref;
+	ref->color[pos] = player;
+
+	captured = 0;
+	single = PASS;
+	for (i = 0; i < 4; i++) {
+		n = pos + ref_adj[i];
+		if (ref->color[n] == -player && ref_group(ref, n, mark, stones, &size) == 0) {
+			for (j = 0; j < size; j++) {
+				ref->color[stones[j]] = EMPTY;
+			}
+			captured += size;
+			single = n;
+		}
+	}
+
+	libs = ref_group(ref, pos, mark, stones, &size);
+	if (libs == 0) {
+		*ref = old;
+		return -1;
+	}
+
+	ref->ko = (captured == 1 && size == 1 && libs == 1) ? single : PASS;
+	ref->last = player;
+
+	return captured;
+}
+
+static int count_bits(const uint64_t *mask) {
+	int i, n;
+
+	n = 0;
+	for (i = 0; i < GO_MASK_WORDS; i++) {
+		n += __builtin_popcountll(mask[i]);
+	}
+
+	return n;
+}
+
+static void error(const char *what, int pos) {
+
+	if (errors++ < 10) {
+		fprintf(stderr, "mismatch: %s at %d\n", what, pos);
+	}
+}
+
+// checks go_check() and go_legal_mask() against the reference on every 
+// point of <board>
+static void verify_check(struct go_board *board) {
+	uint64_t mask[GO_MASK_WORDS];
+	struct ref ref, copy;
+	int pos, legal, count;
+
+	ref_load(&ref, board);
+
+	if (go_legal_mask(board, board->player, mask) != count_bits(mask)) {
+		error("legal mask count", PASS);
+	}
+
+	count = 0;
+	for (pos = 0; pos < GO_LIMIT(board->dim); pos++) {
+		if (ref.color[pos] == INVAL) {
+			if (GO_MASK_TEST(mask, pos)) {
+				error("legal mask", pos);
+			}
+			continue;
+		}
+
+		copy = ref;
+		legal = (ref_play(&copy, pos, board->player) >= 0);
+
+		if ((go_check(board, pos, board->player) == 0) != legal) {
+			error("legality", pos);
+		}
+		if ((int) GO_MASK_TEST(mask, pos) != legal) {
+			error("legal mask", pos);
+		}
+	}
+}
+
+// checks the result of go_place(<move>) on <board> against the reference
+// applied to the position before it, <before>
+static void verify_place(struct go_board *board, struct ref *before, int move, int player, int captured) {
+	uint8_t mark[GO_SIZE];
+	int stones[GO_SIZE];
+	int pos, size;
+
+	if (ref_play(before, move, player) != captured) {
+		error("captures", move);
+	}
+
+	if (before->ko != board->ko) {
+		error("ko", move);
+	}
+
+	for (pos = 0; pos < GO_LIMIT(board->dim); pos++) {
+		if (before->color[pos] != board->pos[pos].color) {
+			error("color", pos);
+		}
+		else if ((before->color[pos] == BLACK || before->color[pos] == WHITE)
+				&& ref_group(before, pos, mark, stones, &size) != go_get_libs(board, pos)) {
+			error("liberties", pos);
+		}
+	}
+}
+
+// checks the state that go_place() and go_undo() update incrementally, the 
+// stone hash and, when they are enabled, the pattern codes and the tactics
+// lists, against a recomputation from the stones of <board>
+static void verify_incremental(struct go_board *board) {
+	static const int heads[2] = { GO_ATARI, GO_TWO_LIBS };
+	struct ref ref;
+	uint8_t mark[GO_SIZE];
+	uint8_t done[GO_SIZE];
+	int stones[GO_SIZE];
+	uint64_t hash;
+	int groups[2];
+	int pos, g, p, libs, size, ok, i, j, n;
+
+	ref_load(&ref, board);
+	memset(done, 0, sizeof(done));
+	groups[0] = groups[1] = 0;
+
+	hash = 0;
+	for (pos = 0; pos < GO_LIMIT(board->dim); pos++) {
+		if (ref.color[pos] == BLACK || ref.color[pos] == WHITE) {
+			hash ^= GO_ZOBRIST(ref.color[pos], pos);
+		}
+	}
+	if (hash != board->hash) {
+		error("stone hash", PASS);
+	}
+
+	for (pos = 0; pos < GO_LIMIT(board->dim); pos++) {
+		if (ref.color[pos] == INVAL) {
+			continue;
+		}
+
+		if (board->pos[pos].pat3 != go_pat3(board, pos)) {
+			error("pattern code", pos);
+		}
+
+		if (ref.color[pos] == EMPTY || done[pos]) {
+			continue;
+		}
+
+		// every group is listed iff it has one or two liberties, and then
+		// its leader holds them
+		libs = ref_group(&ref, pos, mark, stones, &size);
+		for (i = 0; i < size; i++) {
+			done[stones[i]] = 1;
+		}
+
+		g = go_get_group(board, pos);
+		if ((libs >= 1 && libs <= 2) != (board->pos[g].lnext != PASS)) {
+			error("tactics list membership", g);
+			continue;
+		}
+
+		if (libs < 1 || libs > 2) {
+			continue;
+		}
+		groups[libs - 1]++;
+
+		for (i = 0; i < libs; i++) {
+			p = board->pos[g].lib[i];
+			ok = 0;
+			if ((unsigned) p < (unsigned) GO_LIMIT(board->dim) && ref.color[p] == EMPTY) {
+				for (j = 0; j < 4; j++) {
+					ok |= mark[p + ref_adj[j]];
+				}
+			}
+			if (!ok || (i == 1 && p == board->pos[g].lib[0])) {
+				error("tactics liberty", g);
+			}
+		}
+	}
+
+	// and each list is linked both ways, and holds only such groups
+	for (i = 0; i < 2; i++) {
+		n = 0;
+		for (g = board->pos[heads[i]].lnext; g != heads[i] && n <= GO_SIZE; g = board->pos[g].lnext) {
+			n++;
+
+			if ((unsigned) g >= (unsigned) GO_LIMIT(board->dim) || ref.color[g] == EMPTY || ref.color[g] == INVAL
+					|| board->pos[board->pos[g].lnext].lprev != g || go_get_group(board, g) != g 
+					|| ref_group(&ref, g, mark, stones, &size) != i + 1) {
+				error("tactics list", g);
+				break;
+			}
+		}
+
+		if (n != groups[i]) {
+			error("tactics list length", heads[i]);
+		}
+	}
+}
+
+/*****************************************************************************
+ * perft, sample
+ *
+ * Walk every sequence of <depth> moves from <board>, or one sequence of 
+ * random moves, adding each position reached at depth d to <counts[d]>. 
+ * <board> is restored before returning.
+ */
+
+static int legal_moves(struct go_board *board, int *moves) {
+	int pos, n;
+
+	if (verify) {
+		verify_check(board);
+	}
+
+	n = 0;
+	for (pos = 0; pos < GO_LIMIT(board->dim); pos++) {
+		if (!go_check(board, pos, board->player)) {
+			moves[n++] = pos;
+		}
+	}
+
+	return n;
+}
+
+static void play(struct go_board *board, int move, int ply) {
+	struct ref before;
+	int player, captured;
+
+	player = board->player;
+	if (verify) {
+		ref_load(&before, board);
+	}
+
+	captured = board->empties;
+	go_place(board, move, player);
+	board->player = -player;
+	captured = board->empties - captured + 1;
+
+	if (verify) {
+		verify_place(board, &before, move, player, captured);
+		verify_incremental(board);
+	}
+
+	counts[ply].nodes++;
+	counts[ply].captures += captured;
+	counts[ply].hash += go_hash(board);
+}
+
+static void unplay(struct go_board *board) {
+
+	go_undo(board);
+
+	if (verify) {
+		verify_incremental(board);
+	}
+}
+
+static void perft(struct go_board *board, int ply, int depth) {
+	int moves[GO_MAX_DIM * GO_MAX_DIM];
+	int i, n;
+
+	n = legal_moves(board, moves);
+
+	for (i = 0; i < n; i++) {
+		play(board, moves[i], ply + 1);
+		if (ply + 1 < depth) {
+			perft(board, ply + 1, depth);
+		}
+		unplay(board);
+	}
+}
+
+static void sample(struct go_board *board, int depth, struct rng *rng) {
+	int moves[GO_MAX_DIM * GO_MAX_DIM];
+	int ply, n;
+
+	for (ply = 0; ply < depth; ply++) {
+		n = legal_moves(board, moves);
+		if (n == 0) {
+			break;
+		}
+		play(board, moves[rng_below(rng, n)], ply + 1);
+	}
+
+	while (ply-- > 0) {
+		unplay(board);
+	}
+}
+
+int main(int argc, char **argv) {
+	struct go_board *board;
+	struct rng rng, start_rng;
+	uint64_t seed;
+	double start, time;
+	long nodes;
+	int dim, depth, prefix, samples;
+	int d, i, move, opt;
+
+	dim = 9;
+	depth = 3;
+	seed = 1;
+	prefix = 20;
+	samples = 0;
+
+	while ((opt = getopt(argc, argv, "d:n:s:p:r:v")) != -1) {
+		switch (opt) {
+		case 'd': dim = atoi(optarg); break;
+		case 'n': depth = atoi(optarg); break;
+		case 's': seed = strtoull(optarg, NULL, 0); break;
+		case 'p': prefix = atoi(optarg); break;
+		case 'r': samples = atoi(optarg); break;
+		case 'v': verify = 1; break;
+		default:
+			fprintf(stderr, "usage: calico-perft [-d dim] [-n depth] [-s seed] [-p prefix] [-r samples] [-v]\n");
+			return 1;
+		}
+	}
+
+	board = go_new(dim);
+	if (!board || depth < 1 || depth > MAX_DEPTH) {
+		fprintf(stderr, "unsupported board size or depth\n");
+		return 1;
+	}
+
+	// the start position, reached with the incremental state already on, so
+	// that its moves are checked too
+	if (verify) {
+		go_set_patterns(board, 1);
+		go_set_tactics(board, 1);
+	}
+
+	rng_seed(&rng, seed, 0);
+	for (i = 0; i < prefix; i++) {
+		move = gen_move_light(board, &rng);
+		if (move != PASS) {
+			go_place(board, move, board->player);
+		}
+		board->player = -board->player;
+	}
+
+	board->journal = go_new_journal();
+	start_rng = rng;
+
+	for (d = 1; d <= depth; d++) {
+		memset(counts, 0, sizeof(counts));
+		rng = start_rng;
+
+		start = now();
+		if (samples) {
+			for (i = 0; i < samples; i++) {
+				sample(board, d, &rng);
+			}
+		}
+		else {
+			perft(board, 0, d);
+		}
+		time = now() - start;
+
+		nodes = 0;
+		for (i = 1; i <= d; i++) {
+			nodes += counts[i].nodes;
+		}
+
+		printf("%d\t%ld\t%ld\t%016llx\t%f\t%.0f\n", d, counts[d].nodes, counts[d].captures,
+			(unsigned long long) counts[d].hash, time, nodes / time);
+	}
+
+	go_free_journal(board->journal);
+	free(board);
+
+	if (errors) {
+		fprintf(stderr, "%ld mismatches\n", errors);
+		return 1;
+	}
+
+	return 0;
+}